@@ -8,35 +8,32 @@ See main library header file for details
 /*!
 Define the number of days in each month
 */
-const uint8_t daysInMonth[] PROGMEM = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+const uint8_t monthDays[] PROGMEM = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+/*!
+Bits in each shadowed register that the device can change on its own (OSCRUN, PWRFAIL, weekday and ALMxIF). Order
+matches MCP7940_Class::shadowIndex()
+*/
+const uint8_t shadowHardwareBits[MCP7940_SHADOW_REGISTERS] PROGMEM = { 0x00, 0x00, 0x37, 0x08, 0x08 };
 
 /*!
-* @brief   returns the number of days from a given Y M D value
+* @brief   returns the number of days from 2000-01-01 to a given Y M D value
+* @details Closed form count using a year that starts in March, so the leap day is the last day of the year and the
+*          month lengths follow a fixed 153 days per 5 months pattern. Years are counted from 1600 so the 400 year
+*          leap cycle lines up and the arithmetic stays unsigned and 16 bit apart from the final sum
 * @param[in] y Year
 * @param[in] m Month
 * @param[in] d Day
 * @return    number of days from a given Y M D value
 */
-static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) 
+static uint32_t date2days(uint16_t y, uint8_t m, uint8_t d) 
 {
   if (y >= 2000) 
   {
     y -= 2000;
   } // of if-then year is greater than 2000
-  uint16_t days = d;
-  for (uint8_t i = 1; i < m; ++i) // Add number of days for each month
-  {
-    days += pgm_read_byte(daysInMonth + i - 1);
-  } // of for-next loop for each month
-  if (m > 2 && y % 4 == 0) // Deal with leap years
-  {
-    ++days;
-  } // of if-then a leap year
-  if ( ((y % 100) == 0) && ((y % 400) !=0 )) // if year is divisible by 100 but not by 400 then it is not a l.y.
-  {
-    --days;
-  } // of if-then special leap year
-  return days + 365 * y + (y + 3) / 4 - 1; // Return computed value
+  uint16_t years = y + 400 - (m <= 2);                                  // Jan and Feb belong to the previous year
+  uint16_t doy   = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;     // Day of the March based year
+  return years * 365UL + years / 4 - years / 100 + years / 400 + doy - DAYS_FROM_1600_TO_2000;
 } // of method date2days
 /*!
 * @brief     return the number of seconds for a D H M S value
@@ -47,7 +44,7 @@ static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d)
 * @return    number of seconds for a Days/Hours/Minutes/Seconds value
 
 */
-static long time2long(uint16_t days, uint8_t h, uint8_t m, uint8_t s) 
+static long time2long(uint32_t days, uint8_t h, uint8_t m, uint8_t s) 
 {
   return ((days * 24L + h) * 60 + m) * 60 + s;
 } // of method time2long
@@ -80,22 +77,23 @@ DateTime::DateTime (uint32_t t)
   mm = t % 60;
   t /= 60;
   hh = t % 24;
-  uint16_t days = t / 24;
-  uint8_t leap;
-  for (yOff = 0; ; ++yOff)
-  {
-    leap = yOff % 4 == 0;
-    if (days < (uint16_t)365 + leap) break;
-    days -= 365 + leap;
-  } // of for-next each year
-  for (m = 1; ; ++m) 
-  {
-    uint8_t daysPerMonth = pgm_read_byte(daysInMonth + m - 1);
-    if (leap && m == 2) ++daysPerMonth;
-    if (days < daysPerMonth) break;
-    days -= daysPerMonth;
-  } // of for-next each month
-  d = days + 1;
+  uint32_t days = t / 24;
+  uint16_t base = 2000;                    // Days are counted in 400 year eras starting on 1 March of a leap century
+  if (days >= 60)                          // 2000-03-01, the start of the current era
+  {
+    days -= 60;
+  }
+  else
+  {
+    days += DAYS_PER_400_YEARS - 60;       // Jan and Feb 2000 are the end of the previous era
+    base  = 1600;
+  } // of if-then-else before March 2000
+  uint16_t years = (days - days / 1460 + days / 36524 - days / 146096) / 365;       // Year of the era
+  uint16_t doy   = days - (years * 365UL + years / 4 - years / 100);                // Day of the March based year
+  uint8_t  mp    = (5 * doy + 2) / 153;                                            // March based month
+  m    = mp < 10 ? mp + 3 : mp - 9;
+  yOff = base + years + (m <= 2) - 2000;
+  d    = doy - (153 * mp + 2) / 5 + 1;
 } // of method DateTime()
 /*!
 * @brief   DateTime constructor (overloaded)
@@ -173,33 +171,114 @@ DateTime::DateTime (const __FlashStringHelper* date, const __FlashStringHelper*
   DateTime(date_buff, time_buff); // Call actual DateTime constructor
 } // of method DateTime()
 
-//NONOFFICIAL CFraser modifications to adjust month for next two methods
-//increase month by 1
+//NONOFFICIAL CFraser modifications to step the date and time, up to dayOfTheWeek()
+//increase month by 1, December goes to January of the next year
 void	   DateTime::incMonth()
 {
-	if(m == 12) {
-		m = 0;
-		yOff++;
+	if(m >= 12) {
+		m = 1;
+		incYear();
 	} else
 		m++;
 
 }
-//decrease month by 1
+//decrease month by 1, January goes to December of the previous year
 void	   DateTime::decMonth()
 {
-	if(m == 0) {
+	if(m <= 1) {
 		m = 12;
-		yOff--;
+		decYear();
 	} else
 		m--;
 }
+//increase year by 1, wraps within the 2000-2099 the RTC can hold
+void	   DateTime::incYear()
+{
+	yOff = yOff >= 99 ? 0 : yOff + 1;
+}
+//decrease year by 1, wraps within the 2000-2099 the RTC can hold
+void	   DateTime::decYear()
+{
+	yOff = (yOff == 0 || yOff > 99) ? 99 : yOff - 1;
+}
+//2100 and 2200 are the only century years in range and aren't leap years
+bool	   DateTime::isLeapYear() const
+{
+	return yOff % 4 == 0 && (yOff % 100 != 0 || yOff == 0);
+}
+//Number of days in the current month
+uint8_t  DateTime::daysInMonth() const
+{
+	if(m < 1 || m > 12)
+		return 31;
+	return pgm_read_byte(monthDays + m - 1) + (m == 2 && isLeapYear());
+}
+//Only ever compares and increments, a second is carried up to the year like the RTC counters do
+void	   DateTime::tick(uint8_t seconds)
+{
+	while(seconds--) {
+		if(++ss < 60)
+			continue;
+		ss = 0;
+		if(++mm < 60)
+			continue;
+		mm = 0;
+		if(++hh < 24)
+			continue;
+		hh = 0;
+		if(++d <= daysInMonth())
+			continue;
+		d = 1;
+		if(++m <= 12)
+			continue;
+		m = 1;
+		incYear();
+	}
+}
+//Adds delta to v and wraps it into lo..hi
+static uint8_t wrapField(uint8_t v, int8_t delta, uint8_t lo, uint8_t hi)
+{
+	int16_t n    = v + delta;
+	int16_t span = hi - lo + 1;
+	while(n > hi)
+		n -= span;
+	while(n < lo)
+		n += span;
+	return n;
+}
+//Steps one field for the set time buttons, the day is pulled back if the month becomes shorter
+void	   DateTime::adjustField(uint8_t field, int8_t delta)
+{
+	switch(field) {
+		case DATETIME_SECOND:
+			ss = wrapField(ss, delta, 0, 59);
+			break;
+		case DATETIME_MINUTE:
+			mm = wrapField(mm, delta, 0, 59);
+			break;
+		case DATETIME_HOUR:
+			hh = wrapField(hh, delta, 0, 23);
+			break;
+		case DATETIME_DAY:
+			d = wrapField(d, delta, 1, daysInMonth());
+			break;
+		case DATETIME_MONTH:
+			m = wrapField(m, delta, 1, 12);
+			break;
+		case DATETIME_YEAR:
+			yOff = wrapField(yOff, delta, 0, 99);
+			break;
+	}
+	if(d > daysInMonth()) //31st into a shorter month, or 29 Feb out of a leap year
+		d = daysInMonth();
+}
 /*!
 * @brief     return the current day-of-week where Monday is day 1, Sunday is 7
 * @return    integer day-of-week 1-7
 */
 uint8_t DateTime::dayOfTheWeek() const 
 {
-  uint16_t day = date2days(yOff, m, d); // compute the number of days
+  uint32_t day = date2days(yOff, m, d); // compute the number of days
   uint8_t  dow = ((day + 6) % 7);       // Jan 1, 2000 is a Saturday, i.e. 6
   if (dow == 0)                         // Correction for Sundays
   {
@@ -213,7 +292,7 @@ uint8_t DateTime::dayOfTheWeek() const
 */
 uint32_t DateTime::unixtime(void) const 
 {
-  uint16_t days = date2days(yOff, m, d);       // Compute days
+  uint32_t days = date2days(yOff, m, d);       // Compute days
   uint32_t    t = time2long(days, hh, mm, ss); // Compute seconds
   t += SECONDS_FROM_1970_TO_2000;
   return t;
@@ -224,7 +303,7 @@ uint32_t DateTime::unixtime(void) const
 */
 long DateTime::secondstime(void) const 
 {
-  uint16_t days = date2days(yOff, m, d);
+  uint32_t days = date2days(yOff, m, d);
   long        t = time2long(days, hh, mm, ss);
   return t;
 } // of method secondstime()
@@ -269,6 +348,57 @@ TimeSpan TimeSpan::operator - (const TimeSpan& right)
   return TimeSpan(_seconds - right._seconds);
 } // of overloaded subtract
 
+/*******************************************************************************************************************
+** Implementation of BCDTime                                                                                      **
+*******************************************************************************************************************/
+/*!
+* @brief     packs a 0-99 value into two BCD digits
+* @param[in] dec value to pack
+* @return    BCD value
+*/
+static uint8_t packBCD(uint8_t dec)
+{
+  uint8_t tens = 0;
+  while (dec >= 10)                     // At most 9 passes, cheaper than a division on the AVR
+  {
+    dec -= 10;
+    tens++;
+  } // of while more tens
+  return (tens << 4) | dec;
+} // of method packBCD
+/*!
+* @brief     unpacks two BCD digits into a value
+* @param[in] bcd BCD value
+* @return    integer value
+*/
+static uint8_t unpackBCD(uint8_t bcd)
+{
+  return (bcd >> 4) * 10 + (bcd & 0x0F);
+} // of method unpackBCD
+BCDTime::BCDTime ()
+{
+  memset(_bcd, 0, sizeof(_bcd));
+} // of method BCDTime()
+BCDTime::BCDTime (const DateTime& dt)
+{
+  _bcd[DATETIME_SECOND] = packBCD(dt.second());
+  _bcd[DATETIME_MINUTE] = packBCD(dt.minute());
+  _bcd[DATETIME_HOUR]   = packBCD(dt.hour());
+  _bcd[DATETIME_DAY]    = packBCD(dt.day());
+  _bcd[DATETIME_MONTH]  = packBCD(dt.month());
+  _bcd[DATETIME_YEAR]   = packBCD(dt.year() - 2000);
+} // of method BCDTime()
+/*!
+* @brief     return the BCD time as a DateTime
+* @return    DateTime with the same fields
+*/
+DateTime BCDTime::toDateTime() const
+{
+  return DateTime(2000 + unpackBCD(_bcd[DATETIME_YEAR]), unpackBCD(_bcd[DATETIME_MONTH]),
+                  unpackBCD(_bcd[DATETIME_DAY]), unpackBCD(_bcd[DATETIME_HOUR]),
+                  unpackBCD(_bcd[DATETIME_MINUTE]), unpackBCD(_bcd[DATETIME_SECOND]));
+} // of method toDateTime()
+
 /*!
     @brief     Start I2C device communications
     @details   Starts I2C communications with the device, using a default address if one is not specified
@@ -301,11 +431,21 @@ bool MCP7940_Class::begin(const uint32_t i2cSpeed)
 */
 uint8_t MCP7940_Class::readByte(const uint8_t addr)
 {
+  int8_t shadow = shadowIndex(addr);             // Shadow slot, -1 if not shadowed
+  if (shadow >= 0 && bitRead(_ShadowValid, shadow))
+  {
+    return _Shadow[shadow];                      // No bus traffic for a cached register
+  } // of if-then register is cached
   Wire.beginTransmission(MCP7940_ADDRESS);       // Address the I2C device
   Wire.write(addr);                              // Send the register address to read
   _TransmissionStatus = Wire.endTransmission();  // Close transmission
-  Wire.requestFrom(MCP7940_ADDRESS, (uint8_t)1); // Request 1 byte of data
-  return Wire.read();                            // read it and return it
+  uint8_t count = Wire.requestFrom(MCP7940_ADDRESS, (uint8_t)1); // Request 1 byte of data
+  uint8_t data = Wire.read();                    // read it
+  if (_TransmissionStatus == 0 && count == 1)
+  {
+    updateShadow(addr, data);                    // Keep the shadow copy current
+  } // of if-then byte was read
+  return data;
 } // of method readByte()
 /*!
     @brief     Write a single byte to the address specified
@@ -317,7 +457,185 @@ void MCP7940_Class::writeByte(const uint8_t addr, const uint8_t data)
   Wire.write(addr);                             // Send register address to write
   Wire.write(data);                             // Send data to write to register
   _TransmissionStatus = Wire.endTransmission(); // Close transmission
+  if (_TransmissionStatus == 0)
+  {
+    updateShadow(addr, data);                   // Write through to the shadow copy once the device has it
+  } // of if-then write succeeded
 } // of method writeByte()
+/*!
+    @brief     Write a block of consecutive registers starting at the address specified
+    @details   The MCP7940 auto-increments its register pointer, so the block goes out as one transaction unless it
+               is larger than the Wire buffer, in which case it is split into buffer sized transactions
+    @param[in] addr I2C device register address of the first byte
+    @param[in] data Pointer to the bytes to write
+    @param[in] len  Number of bytes to write
+*/
+void MCP7940_Class::writeBlock(const uint8_t addr, const uint8_t* data, const uint8_t len)
+{
+  uint8_t reg = addr;
+  uint8_t remaining = len;
+  while (remaining > 0)                                  // Loop for each buffer sized block
+  {
+    uint8_t chunk = remaining;
+    if (chunk > BUFFER_LENGTH - 1)                       // Leave room for the register address
+    {
+      chunk = BUFFER_LENGTH - 1;
+    } // of if-then block is too large for one transmission
+    Wire.beginTransmission(MCP7940_ADDRESS);             // Address the I2C device
+    Wire.write(reg);                                     // Send register address to write
+    for (uint8_t i = 0; i < chunk; i++)                  // Send each data byte
+    {
+      Wire.write(data[i]);
+    } // of for-next each byte
+    _TransmissionStatus = Wire.endTransmission();        // Close transmission
+    if (_TransmissionStatus)
+    {
+      break;                                             // Leave the error status for the caller
+    } // of if-then transmission error
+    for (uint8_t i = 0; i < chunk; i++)                  // Write through to the shadow copy once the device
+    {                                                    // has the bytes
+      updateShadow(reg + i, data[i]);
+    } // of for-next each byte
+    data      += chunk;
+    reg       += chunk;
+    remaining -= chunk;
+  } // of while bytes left to write
+} // of method writeBlock()
+/*!
+    @brief     Read a block of consecutive registers starting at the address specified
+    @details   Split into Wire buffer sized requests if the block is larger than the buffer
+    @param[in] addr I2C device register address of the first byte
+    @param[out] data Pointer to storage for the bytes read
+    @param[in] len  Number of bytes to read
+    @return    Number of bytes actually read
+*/
+uint8_t MCP7940_Class::readBlock(const uint8_t addr, uint8_t* data, const uint8_t len)
+{
+  uint8_t reg       = addr;
+  uint8_t remaining = len;
+  uint8_t bytesRead = 0;
+  while (remaining > 0)                                  // Loop for each buffer sized block
+  {
+    uint8_t chunk = remaining;
+    if (chunk > BUFFER_LENGTH)
+    {
+      chunk = BUFFER_LENGTH;
+    } // of if-then block is too large for one request
+    Wire.beginTransmission(MCP7940_ADDRESS);             // Address the I2C device
+    Wire.write(reg);                                     // Send the register address to read
+    _TransmissionStatus = Wire.endTransmission();        // Close transmission
+    if (_TransmissionStatus || Wire.requestFrom(MCP7940_ADDRESS, chunk) != chunk)
+    {
+      break;                                             // Device didn't answer, stop here
+    } // of if-then transmission error
+    for (uint8_t i = 0; i < chunk; i++)                  // Store each byte
+    {
+      *data++ = Wire.read();
+    } // of for-next each byte
+    bytesRead += chunk;
+    reg       += chunk;
+    remaining -= chunk;
+  } // of while bytes left to read
+  return bytesRead;
+} // of method readBlock()
+/*!
+    @brief     Return the shadow slot used for a register
+    @param[in] reg Register address
+    @return    Index into _Shadow, or -1 if the register is not shadowed
+*/
+int8_t MCP7940_Class::shadowIndex(const uint8_t reg)
+{
+  switch (reg)
+  {
+    case MCP7940_CONTROL:   return 0;
+    case MCP7940_OSCTRIM:   return 1;
+    case MCP7940_RTCWKDAY:  return 2;
+    case MCP7940_ALM0WKDAY: return 3;
+    case MCP7940_ALM1WKDAY: return 4;
+    default:                return -1;
+  } // of switch register address
+} // of method shadowIndex()
+/*!
+    @brief     Store a register value in the shadow copy if shadowing is enabled and the register is shadowed
+    @param[in] reg  Register address
+    @param[in] data Value read from or written to the register
+*/
+void MCP7940_Class::updateShadow(const uint8_t reg, const uint8_t data)
+{
+  int8_t shadow = shadowIndex(reg);
+  if (_ShadowEnabled && shadow >= 0)
+  {
+    _Shadow[shadow] = data;
+    bitSet(_ShadowValid, shadow);
+  } // of if-then register is shadowed
+} // of method updateShadow()
+/*!
+    @brief     Turn the register shadow on or off
+    @details   With the shadow on, CONTROL, OSCTRIM, RTCWKDAY, ALM0WKDAY and ALM1WKDAY are kept in memory. Reads of
+               those registers cost no bus traffic once cached, and bit changes in CONTROL and OSCTRIM become a
+               single write. Bits the device changes on its own (OSCRUN, PWRFAIL, the weekday and ALMxIF) are always
+               read from the device when asked for through the bit accessors and before a register holding them is
+               changed, which refreshes the copy. Other bits are only written back from the copy, so call
+               invalidateRegisters() if something else may have changed the device
+    @param[in] state true to enable the shadow, false to always read the device
+*/
+void MCP7940_Class::setRegisterShadow(const bool state)
+{
+  _ShadowEnabled = state;
+  _ShadowValid   = 0; // Start with an empty shadow either way
+} // of method setRegisterShadow()
+/*!
+    @brief     Discard the shadow copy so every shadowed register is read from the device on next use
+*/
+void MCP7940_Class::invalidateRegisters()
+{
+  _ShadowValid = 0;
+} // of method invalidateRegisters()
+/*!
+    @brief     Discard the shadow copy of a register if the given bits can change without a write from this class
+    @param[in] reg  Register address
+    @param[in] bits Mask of bits about to be read
+*/
+void MCP7940_Class::invalidateHardwareBits(const uint8_t reg, const uint8_t bits)
+{
+  int8_t shadow = shadowIndex(reg);
+  if (shadow >= 0 && (pgm_read_byte(shadowHardwareBits + shadow) & bits))
+  {
+    bitClear(_ShadowValid, shadow);
+  } // of if-then bits are owned by the device
+} // of method invalidateHardwareBits()
+/*!
+    @brief     Read a register that is about to be changed and written back
+    @details   The shadow copy may hold a stale weekday, PWRFAIL or ALMxIF, and writing those back would undo what
+               the device did since, so registers with device owned bits are read live. CONTROL and OSCTRIM still
+               come from the shadow
+    @param[in] reg Register address
+    @return    Register value to modify
+*/
+uint8_t MCP7940_Class::readForWrite(const uint8_t reg)
+{
+  int8_t shadow = shadowIndex(reg);
+  if (shadow >= 0)
+  {
+    invalidateHardwareBits(reg, pgm_read_byte(shadowHardwareBits + shadow));
+  } // of if-then register is shadowed
+  return readByte(reg);
+} // of method readForWrite()
+/*!
+    @brief     Wait for the oscillator to reach the requested state
+    @param[in] state true to wait for the oscillator to run, false to wait for it to stop
+    @return    The final oscillator state
+*/
+bool MCP7940_Class::waitForOscillator(const bool state)
+{
+  for (uint8_t j = 0; j < 255; j++)                                        // Loop until changed or overflow
+  {
+    _OscillatorStatus = readRegisterBit(MCP7940_RTCWKDAY, MCP7940_OSCRUN); // Read oscillator state
+    if (_OscillatorStatus == state) break;                                 // Exit loop on success
+    delay(1);                                                              // Allow oscillator time to change
+  } // of for-next oscillator loop
+  return _OscillatorStatus;
+} // of method waitForOscillator()
 /*!
     @brief     clears a specified bit in a register on the device
     @param[in] reg Register to write to
@@ -325,7 +643,7 @@ void MCP7940_Class::writeByte(const uint8_t addr, const uint8_t data)
 */
 void MCP7940_Class::clearRegisterBit(const uint8_t reg, const uint8_t b)
 {
-  writeByte(reg, readByte(reg) & ~(1 << b));
+  writeByte(reg, readForWrite(reg) & ~(1 << b));
 } // of method clearRegisterBit()
 /*!
     @brief     sets a specified bit in a register on the device
@@ -334,7 +652,7 @@ void MCP7940_Class::clearRegisterBit(const uint8_t reg, const uint8_t b)
 */
 void MCP7940_Class::setRegisterBit(const uint8_t reg, const uint8_t b)
 {
-  writeByte(reg, readByte(reg) | (1 << b));
+  writeByte(reg, readForWrite(reg) | (1 << b));
 } // of method setRegisterBit()
 /*!
     @brief     Sets or clears the specified bit based on bitvalue
@@ -354,6 +672,7 @@ void MCP7940_Class::writeRegisterBit(const uint8_t reg, const uint8_t b, const b
  */
 uint8_t MCP7940_Class::readRegisterBit(const uint8_t reg, const uint8_t b) 
 {
+  invalidateHardwareBits(reg, 1 << b); // Always read bits the device may change
   return bitRead(readByte(reg), b);
 } // of method readRegisterBit()
 /*!
@@ -385,21 +704,36 @@ bool MCP7940_Class::deviceStatus()
 } // of method DeviceStatus
 /*!
     @brief  Start the MCP7940 device
-    @details Sets the status register to turn on the device clock 
-    @return Success status true if successful otherwise false
+    @details Sets the status register to turn on the device clock. Waiting polls OSCRUN for up to 255ms, pass
+             false to return straight away and poll getOscillatorState() instead
+    @param[in] wait true to wait for the oscillator to start, false to only set ST
+    @return Success status true if the oscillator is running otherwise false
  */
-bool MCP7940_Class::deviceStart() 
+bool MCP7940_Class::deviceStart(const bool wait) 
 {
-  setRegisterBit(MCP7940_RTCSEC, MCP7940_ST);                              // Set the ST bit
-  _CrystalStatus = readRegisterBit(MCP7940_RTCSEC, MCP7940_ST);            // Get status bit from register
-  for (uint8_t j = 0; j < 255; j++)                                        // Loop until changed or overflow
+  uint8_t seconds = readByte(MCP7940_RTCSEC);                             // Running clocks need no write
+  if (!bitRead(seconds, MCP7940_ST))
   {
-    _OscillatorStatus = readRegisterBit(MCP7940_RTCWKDAY, MCP7940_OSCRUN); // Wait for oscillator to start
-    if (_OscillatorStatus) break;                                          // Exit loop on success
-    delay(1);                                                              // Allow oscillator time to start
-  } // of for-next oscillator loop
-  return _OscillatorStatus;
+    writeByte(MCP7940_RTCSEC, seconds | (1 << MCP7940_ST));                // Set the ST bit
+    seconds = readByte(MCP7940_RTCSEC);
+  } // of if-then oscillator not enabled
+  _CrystalStatus = bitRead(seconds, MCP7940_ST);                           // Status bit from register
+  if (!wait)
+  {
+    return getOscillatorState();                                           // Running already or not
+  } // of if-then don't wait
+  return waitForOscillator(true);                                          // Wait for oscillator to start
 } // of method deviceStart
+/*!
+    @brief  Reads whether the oscillator is running
+    @details Reads OSCRUN from the device, it comes on a while after ST is set once the crystal is stable
+    @return true if the oscillator is running
+ */
+bool MCP7940_Class::getOscillatorState()
+{
+  _OscillatorStatus = readRegisterBit(MCP7940_RTCWKDAY, MCP7940_OSCRUN);   // Read oscillator state
+  return _OscillatorStatus;
+} // of method getOscillatorState
 /*!
     @brief  Stop the MCP7940 device
     @details Sets the status register to turn off the device clock
@@ -409,12 +743,7 @@ bool MCP7940_Class::deviceStop()
 {
   clearRegisterBit(MCP7940_RTCSEC, MCP7940_ST);                            // clear the ST bit.
   _CrystalStatus = 0;                                                      // set to false for off status
-  for (uint8_t j = 0; j < 255; j++) {                                      // Loop until changed or overflow
-    _OscillatorStatus = readRegisterBit(MCP7940_RTCWKDAY, MCP7940_OSCRUN); // Wait for oscillator to stop
-    if (!_OscillatorStatus) break;                                         // Exit loop on success
-    delay(1);                                                              // Allow oscillator time to stop
-  } // of for-next oscillator loop
-  return _OscillatorStatus;
+  return waitForOscillator(false);                                         // Wait for oscillator to stop
 } // of method deviceStop
 /*!
     @brief   returns the current date/time
@@ -423,19 +752,54 @@ bool MCP7940_Class::deviceStop()
  */
 DateTime MCP7940_Class::now()
 {
-  Wire.beginTransmission(MCP7940_ADDRESS);       // Address the I2C device
-  Wire.write(MCP7940_RTCSEC);                    // Start at specified register
-  _TransmissionStatus = Wire.endTransmission();  // Close transmission
-  Wire.requestFrom(MCP7940_ADDRESS, (uint8_t)7); // Request 7 bytes of data
-  _ss = bcd2int(Wire.read() & 0x7F);             // Clear high bit in seconds
-  _mm = bcd2int(Wire.read() & 0x7F);             // Clear high bit in minutes
-  _hh = bcd2int(Wire.read() & 0x3F);             // Keep only 6 LSB bits
-  Wire.read();                                   // Ignore Day-Of-Week register
-  _d = bcd2int(Wire.read()  & 0x3F);             // Clear 2 high bits for day-of-month
-  _m = bcd2int(Wire.read()  & 0x1F);             // Clear 3 high bits for Month
-  _y = bcd2int(Wire.read()) + 2000;              // Add 2000 to internal year
-  return DateTime (_y, _m, _d, _hh, _mm, _ss);   // Return class value
+  return nowBCD().toDateTime();                  // Same single burst read
 } // of method now
+/*!
+    @brief   reads the current date/time, reporting a failed read
+    @param[out] dt Current date/time, left as it was if the device didn't answer
+    @return  true if the time was read
+*/
+bool MCP7940_Class::now(DateTime& dt)
+{
+  BCDTime bcd;
+  if (!nowBCD(bcd))
+  {
+    return false;
+  } // of if-then read failed
+  dt = bcd.toDateTime();
+  return true;
+} // of method now
+/*!
+    @brief   returns the current date/time as packed BCD, straight from the registers
+    @details Reads all 7 timekeeping registers in one burst and only masks off the control bits
+    @return  BCDTime class value for the current Date/Time
+ */
+BCDTime MCP7940_Class::nowBCD()
+{
+  BCDTime bcd;
+  nowBCD(bcd);                                   // All zero if the read failed
+  return bcd;
+} // of method nowBCD
+/*!
+    @brief   reads the current date/time as packed BCD, reporting a failed read
+    @param[out] bcd Current date/time, left as it was if the device didn't answer
+    @return  true if the time was read
+*/
+bool MCP7940_Class::nowBCD(BCDTime& bcd)
+{
+  uint8_t registers[7];                          // RTCSEC to RTCYEAR
+  if (readBlock(MCP7940_RTCSEC, registers, sizeof(registers)) != sizeof(registers))
+  {
+    return false;
+  } // of if-then read failed
+  bcd.setRaw(DATETIME_SECOND, registers[0] & 0x7F); // Clear ST bit in seconds
+  bcd.setRaw(DATETIME_MINUTE, registers[1] & 0x7F); // Clear high bit in minutes
+  bcd.setRaw(DATETIME_HOUR,   registers[2] & 0x3F); // Keep only 6 LSB bits
+  bcd.setRaw(DATETIME_DAY,    registers[4] & 0x3F); // Clear 2 high bits for day-of-month, skip Day-Of-Week
+  bcd.setRaw(DATETIME_MONTH,  registers[5] & 0x1F); // Clear 3 high bits for Month
+  bcd.setRaw(DATETIME_YEAR,   registers[6]);        // Two digit year
+  return true;
+} // of method nowBCD
 /*!
     @brief   returns the date/time that the power went off
     @details This is set back to zero once the power fail flag is reset.
@@ -487,22 +851,41 @@ void MCP7940_Class::adjust()
 } // of method "adjust()"
 /*!
     @brief   sets the current date/time (overloaded)
-    @details This is an overloaded function. Set to the DateTime class instance value. The oscillator is stopped 
-             during the process and is restarted upon completion.
+    @details This is an overloaded function. Set to the DateTime class instance value. If calibrate(),
+             calibrateOrAdjust() or setSetUnixTime() have left a calibration record in SRAM, the time set becomes
+             the start of its timespan. Without one SRAM is not touched, so sketches that never calibrate can use
+             all 64 bytes.
 */
 void MCP7940_Class::adjust(const DateTime& dt)
 {
-  deviceStop();                                           // Stop the oscillator
-  writeByte(MCP7940_RTCSEC,   int2bcd(dt.second()));      // Write seconds, keep device off
-  writeByte(MCP7940_RTCMIN,   int2bcd(dt.minute()));      // Write the minutes value
-  writeByte(MCP7940_RTCHOUR,  int2bcd(dt.hour()));        // Also re-sets the 24Hour clock on
-  weekdayWrite(dt.dayOfTheWeek());                        // Update the weekday
-  writeByte(MCP7940_RTCDATE,  int2bcd(dt.day()));         // Write the day of month
-  writeByte(MCP7940_RTCMTH,   int2bcd(dt.month()));       // Month, ignore R/O leapyear bit
-  writeByte(MCP7940_RTCYEAR,  int2bcd(dt.year() - 2000)); // Write the year
-  deviceStart();                                          // Restart the oscillator
-  _SetUnixTime = now().unixtime();                        // Store time of last change
+  setTime(dt);
+  CalibrationRecord record;
+  if (readRAM(MCP7940_CAL_RAM_ADDR, record) == sizeof(record) && record.magic == MCP7940_CAL_MAGIC)
+  {
+    startReference(dt, 0);                                                 // Drift is measured from here
+  } // of if-then calibration in use
 } // of method adjust
+/*!
+    @brief   writes the timekeeping registers without touching the calibration record
+    @details The oscillator is stopped during the process and is restarted upon completion. All seven timekeeping
+             registers are written in a single burst, the ST bit in RTCSEC restarts the oscillator and the rest of
+             the burst lands well before the first seconds increment.
+*/
+void MCP7940_Class::setTime(const DateTime& dt)
+{
+  uint8_t registers[7];                                                    // RTCSEC through RTCYEAR
+  deviceStop();                                                            // Stop the oscillator
+  registers[0] = int2bcd(dt.second()) | (1 << MCP7940_ST);                 // Seconds, restarts the oscillator
+  registers[1] = int2bcd(dt.minute());                                     // Minutes
+  registers[2] = int2bcd(dt.hour());                                       // Also re-sets the 24Hour clock on
+  registers[3] = (readForWrite(MCP7940_RTCWKDAY) & B11111000) | dt.dayOfTheWeek(); // Keep VBATEN, new weekday
+  registers[4] = int2bcd(dt.day());                                        // Day of month
+  registers[5] = int2bcd(dt.month());                                      // Month, ignore R/O leapyear bit
+  registers[6] = int2bcd(dt.year() - 2000);                                // Year
+  writeBlock(MCP7940_RTCSEC, registers, sizeof(registers));                // Write all registers at once
+  _CrystalStatus = true;                                                   // ST bit was written above
+  waitForOscillator(true);                                                 // Wait for oscillator to start
+} // of method setTime
 /*!
     @brief   return the weekday number from the RTC
     @details This number is user-settable and is incremented when the day shifts. It is set as part of the adjust() method where Monday is weekday 1
@@ -510,6 +893,7 @@ void MCP7940_Class::adjust(const DateTime& dt)
 */
 uint8_t MCP7940_Class::weekdayRead() 
 {
+  invalidateHardwareBits(MCP7940_RTCWKDAY, 0x07); // Weekday rolls over at midnight
   return readByte(MCP7940_RTCWKDAY) & 0x07; // no need to convert, values 1-7
 } // of method weekdayRead()
 /*!
@@ -521,7 +905,7 @@ uint8_t MCP7940_Class::weekdayRead()
 */
 uint8_t MCP7940_Class::weekdayWrite(const uint8_t dow) 
 {
-  uint8_t retval = (readByte(MCP7940_RTCWKDAY) & B11111000) | dow; // Read, mask DOW bits & add DOW
+  uint8_t retval = (readForWrite(MCP7940_RTCWKDAY) & B11111000) | dow; // Read, mask DOW bits & add DOW
   if (dow > 0 && dow < 8)                                          // If parameter is in range, then
   {
     writeByte(MCP7940_RTCWKDAY, retval);                           // Write the register
@@ -529,6 +913,38 @@ uint8_t MCP7940_Class::weekdayWrite(const uint8_t dow)
   } // of if-then we have a good DOW
   return retval;
 } // of method weekdayWrite()
+/*******************************************************************************************************************
+** Implementation of the MCP7940_Class calibration and OSCTRIM methods                                            **
+*******************************************************************************************************************/
+/*!
+* @brief     scales a drift to trim steps, rounded to the nearest step
+* @details   Each step of OSCTRIM adds or removes 2 clocks a minute, so gaining "gained" units over "span" units
+*            needs gained * 32768 * 60 / 2 / span steps. Everything is in 64 bits so any drift the callers can
+*            measure is safe, and the result is clamped to twice the register range
+* @param[in] gained Drift, positive when the clock runs fast
+* @param[in] span   Period the drift was measured over, in the same units
+* @return    trim steps, -254 to 254
+*/
+static int16_t trimSteps(int64_t gained, int64_t span)
+{
+  int64_t scaled = gained * MCP7940_TRIM_SCALE;
+  scaled += scaled < 0 ? -(span / 2) : span / 2;          // Round half away from zero
+  scaled /= span;
+  return scaled > 254 ? 254 : scaled < -254 ? -254 : (int16_t)scaled;
+} // of method trimSteps
+/*!
+* @brief     parts per million drift, rounded
+* @param[in] gained Seconds gained, positive when the clock runs fast
+* @param[in] span   Seconds the drift was measured over
+* @return    ppm, saturated to the int32_t range
+*/
+static int32_t ppmDrift(int32_t gained, int32_t span)
+{
+  int64_t scaled = (int64_t)gained * 1000000;
+  scaled += scaled < 0 ? -(span / 2) : span / 2;
+  scaled /= span;
+  return scaled > INT32_MAX ? INT32_MAX : scaled < INT32_MIN ? INT32_MIN : (int32_t)scaled;
+} // of method ppmDrift
 /*!
     @brief   Calibrate the MCP7940 (overloaded)
     @details When called with no parameters the internal calibration is reset to 0
@@ -547,6 +963,16 @@ int8_t MCP7940_Class::calibrate()
     @return  Returns the input "newTrim" value
 */
 int8_t MCP7940_Class::calibrate(const int8_t newTrim) 
+{
+  writeTrim(newTrim);
+  startReference(now(), 0);                           // Drift so far was with the old trim
+  return newTrim;
+} // of method calibrate()
+/*!
+    @brief   writes the trim register in fine trim mode
+    @param[in] newTrim Signed trim value, positive values remove clocks
+*/
+void MCP7940_Class::writeTrim(const int8_t newTrim)
 {
   int8_t trim = abs(newTrim);                         // Make a local copy of absolute value
   if (newTrim < 0)                                    // if the trim is less than 0
@@ -555,9 +981,7 @@ int8_t MCP7940_Class::calibrate(const int8_t newTrim)
   } // of if-then value of trim is less than 0
   clearRegisterBit(MCP7940_CONTROL, MCP7940_CRSTRIM); // fine trim mode on, to be safe    //
   writeByte(MCP7940_OSCTRIM, trim);                   // Write value to the trim register //
-  _SetUnixTime = now().unixtime();                    // Store time of last change        //
-  return newTrim;
-} // of method calibrate()
+} // of method writeTrim()
 /*!
     @brief   Calibrate the MCP7940 (overloaded)
     @details When called with a DateTime class value then an internal calibration is performed. Accepts a current 
@@ -565,88 +989,193 @@ int8_t MCP7940_Class::calibrate(const int8_t newTrim)
              depending upon the time difference between the two and how long the timespan between the two is. The 
              longer the period between setting the clock and comparing the difference between real time and 
              indicated time the better the resulting calibration accuracy will be. The datasheet explains the 
-             calibration formula on page 28. First, the error in parts-per-million is computed using 
-             PPM = (SecDev/ExpectedSeconds) * 10000000. Then the trim register is computed using the formula 
-             TRIMVAL = (PPM*32768*60)/(1000000*2). The code below is designed for easy reading, not for performance.
-             The ppm <> 130 is computed by solving the equation for the maximum TRIM value of 127 and computing the 
-             corresponding max and min values for ppm. This allows the trim variable to be one byte rather than a 
-             long integer.
+             calibration formula on page 28, each trim step adds or removes 2 clocks a minute so the change is
+             SecondsGained * 32768 * 60 / (2 * ExpectedSeconds), worked out in 64 bit integers by trimSteps().
+             The start of the timespan, any seconds already set back by calibrateOrAdjust() and the last trim
+             change are kept in the battery-backed SRAM at MCP7940_CAL_RAM_ADDR, so a power cycle doesn't lose
+             them. The RTC is only read to the whole second and set by hand to about a second, so
+             MCP7940_CAL_UNCERTAINTY seconds are taken off the drift before working out the trim, and the trim is
+             left alone while nothing is left over, the timespan carrying on until there is. A change in the
+             opposite direction to the last one is halved, so the trim settles over repeated calibrations instead
+             of hunting around the right value. Without a stored start time only the time is set.
     @param[in] dt Actual Date/time
     @return  Returns the new calculated trim value
 */
 int8_t MCP7940_Class::calibrate(const DateTime& dt) 
 {
-  int32_t ppm = getPPMDeviation(dt);
-  adjust(dt);								// set the new Date-Time value
-  ppm = constrain(ppm, -130, 130);
-  int16_t trim = readByte(MCP7940_OSCTRIM); // Read current trim register value
-  if (trim >> 7)                           // use negative value if necessary
-  {                     
-    trim = (~0x80 & trim) * -1;
-  } // of if-then trim is set
-  trim += ppm * 32768 * 60 / 2000000;      // compute the new trim value
-  trim = constrain(trim, -127, 127);       // Clamp to value range                            
-  return calibrate((const int8_t)trim);
+  CalibrationRecord record;
+  int32_t gained;
+  int32_t span = calibrationSpan(dt, record, gained);
+  int32_t measured = 0;                          // Drift there certainly is
+  if (gained > MCP7940_CAL_UNCERTAINTY)
+  {
+    measured = gained - MCP7940_CAL_UNCERTAINTY;
+  }
+  else if (gained < -MCP7940_CAL_UNCERTAINTY)
+  {
+    measured = gained + MCP7940_CAL_UNCERTAINTY;
+  } // of if-then-else drift larger than the reading error
+  int16_t step = span > 0 ? trimSteps(measured, span) : 0;
+  if ((step > 0 && record.lastStep < 0) || (step < 0 && record.lastStep > 0))
+  {
+    step -= step / 2;                            // Overshot last time, take a smaller step back
+  } // of if-then step changes direction
+  if (span > 0 && step == 0)
+  {
+    holdReference(dt, record, gained);           // Within a step, let the drift build up
+    return getCalibrationTrim();
+  } // of if-then nothing to trim
+  int16_t trim = constrain(getCalibrationTrim() + step, -127, 127);
+  if (step != 0)
+  {
+    writeTrim((int8_t)trim);
+  } // of if-then trim changed
+  setTime(dt);
+  startReference(dt, constrain(step, -127, 127));
+  return (int8_t)trim;
 } // of method calibrate()
 /*!
     @brief   Calibrate the MCP7940 if the ppm deviation is < 130 and > -130 else Adjust the datetime.
     @details If the time had changed significantly (like happens during daylight savings time) then just
-			 adjust the time to be the new time and leave the trim value alone.  One hour deviation in 6 months
-			 is 225 ppm.  If the ppm deviation is within -130 to 130 then assume we are just calibrating
-			 the clock.  
+             adjust the time to be the new time and leave the trim value alone.  One hour deviation in 6 months
+             is 225 ppm, but a year is only 114 ppm so more than half an hour out is also taken as a change.  If
+             the ppm deviation is within -130 to 130 then assume we are just calibrating the clock. Until
+             MCP7940_CAL_MIN_SPAN has passed the drift is too small to measure, so the time is corrected and the
+             seconds set back are remembered, the timespan carries on and later calls keep converging the trim.
     @param[in] dt Actual Date/time
     @return  Returns the trim value
 */
-int8_t MCP7940_Class::calibrateOrAdjust(const DateTime& dt){
-  int32_t ppm = getPPMDeviation(dt);
-  if ((ppm > 130) || (ppm < -130)){  // calibration is out of range so just set the time  DML 2/5/2019
-	  adjust(dt);
-	  return readByte(MCP7940_OSCTRIM);
-  }else{
-	  return calibrate(dt);
-  }
-}
+int8_t MCP7940_Class::calibrateOrAdjust(const DateTime& dt)
+{
+  CalibrationRecord record;
+  int32_t gained;
+  int32_t span = calibrationSpan(dt, record, gained);
+  int32_t ppm  = span > 0 ? ppmDrift(gained, span) : 0;
+  if (span == 0 || ppm > MCP7940_CAL_MAX_PPM || ppm < -MCP7940_CAL_MAX_PPM ||
+      gained > MCP7940_CAL_MAX_GAIN || gained < -MCP7940_CAL_MAX_GAIN)
+  {
+    setTime(dt);                                 // Calibration is out of range so just set the time  DML 2/5/2019
+    startReference(dt, 0);                       // and measure drift from here
+    return getCalibrationTrim();
+  } // of if-then time was changed
+  if (span < MCP7940_CAL_MIN_SPAN)
+  {
+    holdReference(dt, record, gained);           // Too soon to calibrate
+    return getCalibrationTrim();
+  } // of if-then too soon to calibrate
+  return calibrate(dt);
+} // of method calibrateOrAdjust()
 /*!
-    @brief   Calculate the ppm deviation since the last time the clock was  the MCP7940 if the ppm deviation is < 130 and > -130 else Adjust the datetime.
-    @details If the time had changed significantly (like happens during daylight savings time) then just
-			 adjust the time to be the new time and leave the trim value alone.  One hour deviation in 6 months
-			 is 225 ppm.  If the ppm deviation is within -130 to 130 then assume we are just calibrating
-			 the clock.  
+    @brief   Calculate the ppm deviation since the clock was last set
+    @details Compares the actual time with the RTC over the timespan since the reference time stored in SRAM,
+             counting the seconds already set back by calibrateOrAdjust()
     @param[in] dt Actual Date/time
-    @return  Returns Void
+    @return  Returns the deviation in parts per million, positive when the RTC runs fast, 0 if there is no
+             reference time
 */
-int32_t MCP7940_Class::getPPMDeviation(const DateTime& dt){
-  int32_t SecDeviation = dt.unixtime() - now().unixtime();     // Get difference in seconds
-  int32_t ExpectedSec  = dt.unixtime() - _SetUnixTime;      // Get number of seconds since set
-  int32_t          ppm = 1000000 * SecDeviation / ExpectedSec; // Multiply first to avoid truncation
-  return ppm;
-}
-
+int32_t MCP7940_Class::getPPMDeviation(const DateTime& dt)
+{
+  CalibrationRecord record;
+  int32_t gained;
+  int32_t span = calibrationSpan(dt, record, gained);
+  return span > 0 ? ppmDrift(gained, span) : 0;
+} // of method getPPMDeviation()
+/*!
+    @brief   Read the calibration record and the time gained since its reference time
+    @details An invalid record is returned reset, with no reference time
+    @param[in]  dt     Actual Date/time
+    @param[out] record Calibration record from SRAM
+    @param[out] gained Seconds the RTC is ahead of dt plus any seconds already set back
+    @return  Returns the seconds since the reference time, 0 if there is none or it is in the future
+*/
+int32_t MCP7940_Class::calibrationSpan(const DateTime& dt, CalibrationRecord& record, int32_t& gained)
+{
+  gained = 0;
+  if (readRAM(MCP7940_CAL_RAM_ADDR, record) != sizeof(record) || record.magic != MCP7940_CAL_MAGIC)
+  {
+    record.magic     = MCP7940_CAL_MAGIC;
+    record.reference = 0;
+    record.stepped   = 0;
+    record.lastStep  = 0;
+    return 0;
+  } // of if-then no record
+  uint32_t actual = dt.unixtime();
+  int32_t  span   = (int32_t)(actual - record.reference);
+  if (record.reference == 0 || span <= 0)
+  {
+    return 0;
+  } // of if-then no reference time
+  gained = (int32_t)(now().unixtime() - actual) + record.stepped;
+  return span;
+} // of method calibrationSpan()
+/*!
+    @brief   Correct the time but keep measuring drift from the same reference time
+    @details The time is only written if it is out by 2 seconds or more. Writing it restarts the seconds, which
+             throws away the part of a second the clock has gained so far and adds up to a second of error to the
+             drift measured, and a clock a second out can just be the reading being to the whole second
+    @param[in] dt     Actual Date/time
+    @param[in] record Calibration record read by calibrationSpan()
+    @param[in] gained Seconds gained since the reference time
+*/
+void MCP7940_Class::holdReference(const DateTime& dt, CalibrationRecord& record, const int32_t gained)
+{
+  if (gained - record.stepped < 2 && gained - record.stepped > -2)
+  {
+    return;                                      // As right as reading to the second can tell
+  } // of if-then time is right
+  setTime(dt);
+  record.stepped = constrain(gained, -32767, 32767);
+  writeRAM(MCP7940_CAL_RAM_ADDR, record);
+} // of method holdReference()
+/*!
+    @brief   Start measuring drift from a new reference time
+    @param[in] dt       Time the clock was set to
+    @param[in] lastStep Trim change just made, 0 if none
+*/
+void MCP7940_Class::startReference(const DateTime& dt, const int8_t lastStep)
+{
+  CalibrationRecord record;
+  record.magic     = MCP7940_CAL_MAGIC;
+  record.reference = dt.unixtime();
+  record.stepped   = 0;
+  record.lastStep  = lastStep;
+  writeRAM(MCP7940_CAL_RAM_ADDR, record);
+} // of method startReference()
 /*!
     @brief   Set the time the clock was last calibrated or adjusted.
-    @details Set the internal variable _SetUnixTime.  This is the time the clock was last calibrated or adjusted.  This should only used to testing.  
+    @details Sets the reference time in the SRAM calibration record.  This should only used to testing.  
     @param[in] aTime is the Unix time to set the time the clock was last calibrated or adjusted to.
     @return  void
 */
-void MCP7940_Class::setSetUnixTime(uint32_t aTime){
-	_SetUnixTime = aTime;
-}
+void MCP7940_Class::setSetUnixTime(uint32_t aTime)
+{
+  startReference(DateTime(aTime), 0);
+} // of method setSetUnixTime()
 /*!
     @brief   Get the time the clock was last calibrated or adjusted.
-    @details Returns the internal variable _SetUnixTime.  This is the time the clock was last calibrated or adjusted.  This should only used to testing.  
-    @return  Returns the internal variable _SetUnixTime.
+    @details Returns the reference time from the SRAM calibration record.  This should only used to testing.  
+    @return  Returns the reference time, 0 if there is none
 */
-uint32_t MCP7940_Class::getSetUnixTime(){
-	return _SetUnixTime;
-}
-
+uint32_t MCP7940_Class::getSetUnixTime()
+{
+  CalibrationRecord record;
+  if (readRAM(MCP7940_CAL_RAM_ADDR, record) != sizeof(record) || record.magic != MCP7940_CAL_MAGIC)
+  {
+    return 0;
+  } // of if-then no record
+  return record.reference;
+} // of method getSetUnixTime()
 /*!
-    @brief   Calibrate the MCP7940 (overloaded)
-    @details When called with one floating point value then that is used as the measured frequency
-    @param[in] fMeas Measured frequency in Herz
+    @brief   Calibrate the MCP7940 from a measured SQW frequency
+    @details The measured frequency is given as a whole number of 1/scale Hz, so 1.000040Hz is (1000040, 1000000)
+             and 32768.12Hz is (3276812, 100), and no floating point is needed. The MFP output is trimmed apart
+             from the 32768Hz setting, so the change is added to the current trim except at 32768Hz where the
+             measurement gives the whole trim
+    @param[in] measured Measured frequency in 1/scale Hz
+    @param[in] scale    Units per Hz of measured
     @return  Returns the new trim value
 */
-int8_t MCP7940_Class::calibrate(const float fMeas) 
+int8_t MCP7940_Class::calibrateFrequency(const uint32_t measured, const uint32_t scale) 
 {
   int16_t  trim = getCalibrationTrim(); // Get the current trim
   uint32_t fIdeal = getSQWSpeed();      // read the current SQW Speed code
@@ -660,19 +1189,11 @@ int8_t MCP7940_Class::calibrate(const float fMeas)
           trim   =     0; // Trim is ignored on 32KHz signal
           break;
   } // of switch SQWSpeed value
-  trim += ((fMeas - (float)fIdeal) * (32768.0 / fIdeal) * 60.0) / 2.0; // Use formula from datasheet
-  if (trim > 127) // Force number ppm to be in range
-  {              
-    trim = 127;
-  }
-  else 
-    if (trim < -127) 
-    {
-      trim = -127;
-    } // of if-then-else trim out of range
-  int8_t returnTrim = calibrate((int8_t)trim); // Set the new trim value
-  return(returnTrim);
-} // of method calibrate()
+  int64_t ideal = (int64_t)fIdeal * scale;
+  trim += trimSteps((int64_t)measured - ideal, ideal); // Use formula from datasheet
+  trim  = constrain(trim, -127, 127);   // Force number ppm to be in range
+  return calibrate((int8_t)trim);       // Set the new trim value
+} // of method calibrateFrequency()
 /*!
     @brief   Return the TRIMVAL trim value
     @details Since the number in the register can be negative but is not in excess-128 format any negative numbers 
@@ -749,16 +1270,18 @@ bool MCP7940_Class::setAlarm(const uint8_t alarmNumber, const uint8_t alarmType,
   {  // if parameters and oscillator OK
     clearRegisterBit(MCP7940_CONTROL, alarmNumber ? MCP7940_ALM1EN : MCP7940_ALM0EN); // Turn off the alarm
     uint8_t offset = 7 * alarmNumber;                                 // Offset to be applied
+    uint8_t registers[6];                                             // ALMxSEC through ALMxMTH
     uint8_t wkdayRegister = readByte(MCP7940_ALM0WKDAY + offset);     // Load register to memory
-    wkdayRegister &= ((1 << MCP7940_ALM0IF) | (1 << MCP7940_ALMPOL)); // Keep ALMPOL and ALMxIF bits
+    wkdayRegister &= (1 << MCP7940_ALMPOL);                           // Keep ALMPOL, ALMxIF written 0 clears it
     wkdayRegister |= alarmType << 4;                                  // Set 3 bits from alarmType
     wkdayRegister |= (dt.dayOfTheWeek() & 0x07);                      // Set 3 bits for dow from date
-    writeByte(MCP7940_ALM0WKDAY + offset, wkdayRegister);             // Write alarm mask
-    writeByte(MCP7940_ALM0SEC + offset, int2bcd(dt.second()));        // Write seconds, keep device off
-    writeByte(MCP7940_ALM0MIN + offset, int2bcd(dt.minute()));        // Write the minutes value
-    writeByte(MCP7940_ALM0HOUR + offset, int2bcd(dt.hour()));         // Also re-sets the 24Hour clock on
-    writeByte(MCP7940_ALM0DATE + offset, int2bcd(dt.day()));          // Write the day of month
-    writeByte(MCP7940_ALM0MTH + offset, int2bcd(dt.month()));         // Month, ignore R/O leap-year bit
+    registers[0] = int2bcd(dt.second());                              // Seconds
+    registers[1] = int2bcd(dt.minute());                              // Minutes
+    registers[2] = int2bcd(dt.hour());                                // Hours, 24 hour format
+    registers[3] = wkdayRegister;                                     // Alarm mask and weekday
+    registers[4] = int2bcd(dt.day());                                 // Day of month
+    registers[5] = int2bcd(dt.month());                               // Month, ignore R/O leap-year bit
+    writeBlock(MCP7940_ALM0SEC + offset, registers, sizeof(registers)); // Write all alarm registers at once
     setAlarmState(alarmNumber, state);                                // Set the requested alarm to state
     success = true;
   } // of if-then alarmNumber and alarmType are valid and device running
@@ -897,7 +1420,7 @@ bool MCP7940_Class::setSQWSpeed(uint8_t frequency, bool state)
     bitWrite(registerValue, MCP7940_SQWEN, state);
     bitWrite(registerValue, MCP7940_SQWFS0, bitRead(frequency, 0));
     bitWrite(registerValue, MCP7940_SQWFS1, bitRead(frequency, 1));
-    clearRegisterBit(registerValue, MCP7940_CRSTRIM);        // CRSTRIM bit must be cleared
+    bitClear(registerValue, MCP7940_CRSTRIM);                // CRSTRIM bit must be cleared
     writeByte(MCP7940_CONTROL, registerValue);               // Write register settings
   } else if (frequency == 4)                                 // If the frequency is 64Hz
   { 
@@ -958,6 +1481,63 @@ bool MCP7940_Class::getPowerFail()
 */
 bool MCP7940_Class::clearPowerFail()
 {
+  invalidateHardwareBits(MCP7940_RTCWKDAY, 1 << MCP7940_PWRFAIL); // Need the live register
   writeByte(MCP7940_RTCWKDAY, readByte(MCP7940_RTCWKDAY));
   return true;
 } // of method clearPowerFail()
+/*!
+    @brief     Read a block of bytes from the battery-backed SRAM
+    @details   The 64 byte SRAM wraps around, so a block running past the end continues at the start. The block is
+               read in at most two runs, one each side of the wrap, each split into Wire buffer sized requests
+    @param[in] addr Offset into the SRAM, taken modulo 64
+    @param[out] data Pointer to storage for the bytes read
+    @param[in] len  Number of bytes to read, at most 64
+    @return    Number of bytes actually read
+*/
+uint8_t MCP7940_Class::readRAM(const uint8_t addr, uint8_t* data, const uint8_t len)
+{
+  uint8_t offset    = addr % MCP7940_RAM_SIZE;
+  uint8_t remaining = min(len, MCP7940_RAM_SIZE);
+  uint8_t bytesRead = 0;
+  while (remaining > 0)                                    // At most twice, before and after the wrap
+  {
+    uint8_t run = min(remaining, (uint8_t)(MCP7940_RAM_SIZE - offset));
+    uint8_t got = readBlock(MCP7940_RAM_ADDRESS + offset, data + bytesRead, run);
+    bytesRead += got;
+    if (got != run)
+    {
+      break;                                               // Stop on a bus error
+    } // of if-then short read
+    remaining -= run;
+    offset     = 0;                                        // Continue at the start of the SRAM
+  } // of while bytes left to read
+  return bytesRead;
+} // of method readRAM()
+/*!
+    @brief     Write a block of bytes to the battery-backed SRAM
+    @details   The 64 byte SRAM wraps around, so a block running past the end continues at the start. The block is
+               written in at most two runs, one each side of the wrap, each split into Wire buffer sized writes
+    @param[in] addr Offset into the SRAM, taken modulo 64
+    @param[in] data Pointer to the bytes to write
+    @param[in] len  Number of bytes to write, at most 64
+    @return    Number of bytes written, 0 on a bus error
+*/
+uint8_t MCP7940_Class::writeRAM(const uint8_t addr, const uint8_t* data, const uint8_t len)
+{
+  uint8_t offset       = addr % MCP7940_RAM_SIZE;
+  uint8_t remaining    = min(len, MCP7940_RAM_SIZE);
+  uint8_t bytesWritten = 0;
+  while (remaining > 0)                                    // At most twice, before and after the wrap
+  {
+    uint8_t run = min(remaining, (uint8_t)(MCP7940_RAM_SIZE - offset));
+    writeBlock(MCP7940_RAM_ADDRESS + offset, data + bytesWritten, run);
+    if (_TransmissionStatus)
+    {
+      return 0;                                            // Report the bus error
+    } // of if-then transmission error
+    bytesWritten += run;
+    remaining    -= run;
+    offset        = 0;                                     // Continue at the start of the SRAM
+  } // of while bytes left to write
+  return bytesWritten;
+} // of method writeRAM()
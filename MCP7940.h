@@ -68,6 +68,16 @@
 * 1.0.0b | 2017-07-17 | SV-Zanshin          | Initial coding
 
 * 1.nx   | 2020-12-05 | CFraser             | Added helper methods for increasing/decreasing date my months and years
+* 1.nx   | 2026-10-18 | CFraser             | setSQWSpeed() cleared CRSTRIM in the wrong register
+* 1.nx   | 2026-10-18 | CFraser             | adjust() and setAlarm() write their registers in a single burst
+* 1.nx   | 2026-10-18 | CFraser             | Optional shadow copy of CONTROL, OSCTRIM and the WKDAY registers
+* 1.nx   | 2026-10-18 | CFraser             | readRAM() never stored the data read, writeRAM() overflowed the Wire buffer
+* 1.nx   | 2026-10-18 | CFraser             | Closed form date2days()/DateTime(uint32_t), month and year wrap fixes
+* 1.nx   | 2026-10-18 | CFraser             | tick() and adjustField() step a DateTime without converting to seconds
+* 1.nx   | 2026-10-18 | CFraser             | BCDTime and nowBCD() to read the time as packed BCD digits
+* 1.nx   | 2026-10-18 | CFraser             | Integer drift calibration, reference time and trim history kept in SRAM
+* 1.nx   | 2026-10-18 | CFraser             | calibrate(DateTime) trimmed the wrong way, calibrate(float) is now calibrateFrequency()
+* 1.nx   | 2026-10-18 | CFraser             | now()/nowBCD() overloads that report a failed read, deviceStart() without waiting
 *******************************************************************************************************************/
 
 #include "Arduino.h"  // Arduino data type definitions
@@ -123,6 +133,14 @@
   const uint8_t  MCP7940_PWRUPDATE         =      0x1E; ///< Power-Fail, PWRUPDATE Register address
   const uint8_t  MCP7940_PWRUPMTH          =      0x1F; ///< Power-Fail, PWRUPMTH Register address
   const uint8_t  MCP7940_RAM_ADDRESS       =      0x20; ///< NVRAM - Start address for SRAM
+  const uint8_t  MCP7940_RAM_SIZE          =        64; ///< NVRAM - Bytes of SRAM
+  const uint8_t  MCP7940_CAL_RAM_ADDR      =        56; ///< NVRAM - Calibration record, last 8 bytes of SRAM
+  const uint8_t  MCP7940_CAL_MAGIC         =      0xC7; ///< Marks a valid calibration record
+  const int16_t  MCP7940_CAL_MAX_PPM       =       130; ///< Larger deviations mean the time was changed
+  const int32_t  MCP7940_CAL_MAX_GAIN      =      1800; ///< Larger deviations mean the time was changed
+  const int32_t  MCP7940_CAL_MIN_SPAN      =     86400; ///< Seconds before the drift is worth measuring
+  const int32_t  MCP7940_CAL_UNCERTAINTY   =         2; ///< Seconds a hand set and a reading can be out
+  const int32_t  MCP7940_TRIM_SCALE        =    983040; ///< Trim steps per unit of drift, 32768*60/2
   const uint8_t  MCP7940_ST                =         7; ///< MCP7940 register bits. RTCSEC reg
   const uint8_t  MCP7940_12_24             =         6; ///< RTCHOUR, PWRDNHOUR & PWRUPHOUR
   const uint8_t  MCP7940_AM_PM             =         5; ///< RTCHOUR, PWRDNHOUR & PWRUPHOUR
@@ -142,13 +160,28 @@
   const uint8_t  MCP7940_ALMPOL            =         7; ///< ALM0WKDAY register
   const uint8_t  MCP7940_ALM0IF            =         3; ///< ALM0WKDAY register
   const uint8_t  MCP7940_ALM1IF            =         3; ///< ALM1WKDAY register
+  const uint8_t  MCP7940_SHADOW_REGISTERS  =         5; ///< CONTROL, OSCTRIM, RTCWKDAY, ALM0WKDAY, ALM1WKDAY
   const uint32_t SECONDS_PER_DAY           =     86400; ///< 60 secs * 60 mins * 24 hours
   const uint32_t SECONDS_FROM_1970_TO_2000 = 946684800; ///< Seconds between year 1970 and 2000
+  const uint32_t DAYS_PER_400_YEARS        =    146097; ///< Days in a full leap year cycle
+  const uint32_t DAYS_FROM_1600_TO_2000    =    146037; ///< 1600-03-01 to 2000-01-01, base of date2days()
+  const uint8_t  DATETIME_SECOND           =         0; ///< DateTime::adjustField() field
+  const uint8_t  DATETIME_MINUTE           =         1; ///< DateTime::adjustField() field
+  const uint8_t  DATETIME_HOUR             =         2; ///< DateTime::adjustField() field
+  const uint8_t  DATETIME_DAY              =         3; ///< DateTime::adjustField() field
+  const uint8_t  DATETIME_MONTH            =         4; ///< DateTime::adjustField() field
+  const uint8_t  DATETIME_YEAR             =         5; ///< DateTime::adjustField() field
   /*************************************************************************************************************//*!
   * @class   DateTime
   * @brief   Simple general-purpose date/time class
   * @details Copied from RTClib. For further information on this implementation see 
   *          https://github.com/SV-Zanshin/MCP7940/wiki/DateTimeClass
+  *
+  *          The year is kept as an 8 bit offset from 2000. The MCP7940 holds the year as two BCD digits, so the
+  *          clock runs from 2000 to 2099 and incYear(), decYear(), tick() and adjustField() wrap within that range,
+  *          2099 going on to 2000 as the RTC does. The constructors, dayOfTheWeek() and unixtime() handle offsets up
+  *          to 2106-02-07, where the 32 bit UNIX time runs out, but years past 2099 can't be written to the RTC,
+  *          so widening the offset would only cost RAM in every DateTime.
   *****************************************************************************************************************/
   class DateTime 
   {
@@ -171,16 +204,24 @@
       /*! return the current second */
       uint8_t  second()       const { return ss; }
 	  
-	  //NONOFFICIAL CFraser edits: next 4 methods
+	  //NONOFFICIAL CFraser edits: next 8 methods
 	  
 	  //increase year by 1
-	  void	   incYear()	  { yOff++; }
+	  void	   incYear();
 	  //decrease year by 1
-	  void	   decYear()	  { yOff--; }
+	  void	   decYear();
 	  //increase month by 1
 	  void	   incMonth();
 	  //decrease month by 1
 	  void	   decMonth();
+	  //move forward a number of seconds, carrying into the other fields without converting to seconds
+	  void	   tick(uint8_t seconds=1);
+	  //step a single field, it wraps within its own range and leaves the others alone (day is kept in the month)
+	  void	   adjustField(uint8_t field, int8_t delta);
+	  //number of days in the current month
+	  uint8_t  daysInMonth() const;
+	  //true if the current year is a leap year
+	  bool	   isLeapYear() const;
 	  
 	  
       /*! return the current day of the week starting at 0 */
@@ -196,7 +237,7 @@
       /*! Overloaded "-" operator subtract add two timespans */
       TimeSpan operator-(const DateTime& right);
     protected:
-      uint8_t yOff; ///< Internal year offset value
+      uint8_t yOff; ///< Internal year offset from 2000, 0-99 on the RTC
       uint8_t    m; ///< Internal month value
       uint8_t    d; ///< Internal day value
       uint8_t   hh; ///< Internal hour value
@@ -225,6 +266,25 @@
     protected:
       int32_t _seconds;                                                      ///< Internal value for total seconds
   }; // of class TimeSpan definition
+  /*************************************************************************************************************//*!
+  * @class   BCDTime
+  * @brief   Date/time held as packed BCD, the same way the MCP7940 timekeeping registers hold it
+  * @details NONOFFICIAL CFraser addition. Each field is one byte with the tens digit in the high nibble, indexed by
+  *          the DATETIME_* field constants, so displays can take the digits without dividing by 10
+  *****************************************************************************************************************/
+  class BCDTime
+  {
+    public:
+      BCDTime ();
+      BCDTime (const DateTime& dt);
+      uint8_t  tens(const uint8_t field) const { return _bcd[field] >> 4; }   ///< return the tens digit of a field
+      uint8_t  ones(const uint8_t field) const { return _bcd[field] & 0x0F; } ///< return the ones digit of a field
+      uint8_t  raw(const uint8_t field) const  { return _bcd[field]; }        ///< return the packed BCD field
+      void     setRaw(const uint8_t field, const uint8_t bcd) { _bcd[field] = bcd; } ///< set a packed BCD field
+      DateTime toDateTime() const;
+    protected:
+      uint8_t _bcd[DATETIME_YEAR + 1];                                       ///< Fields in DATETIME_* order
+  }; // of class BCDTime definition
 
   /*************************************************************************************************************//*!
   * @class MCP7940_Class
@@ -237,15 +297,19 @@
       ~MCP7940_Class() {}; ///< Unused Class destructor
       bool     begin(const uint32_t i2cSpeed = I2C_STANDARD_MODE);
       bool     deviceStatus();
-      bool     deviceStart();
+      bool     deviceStart(const bool wait = true);
       bool     deviceStop();
+      bool     getOscillatorState();
       DateTime now();
+      bool     now(DateTime& dt);
+      BCDTime  nowBCD();
+      bool     nowBCD(BCDTime& bcd);
       void     adjust();
       void     adjust(const DateTime& dt);
       int8_t   calibrate();
       int8_t   calibrate(const int8_t newTrim);
       int8_t   calibrate(const DateTime& dt);
-      int8_t   calibrate(const float MeasuredFrequency);
+      int8_t   calibrateFrequency(const uint32_t measured, const uint32_t scale = 1000);
       int8_t   getCalibrationTrim();
       uint8_t  weekdayRead();
       uint8_t  weekdayWrite(const uint8_t dow);
@@ -268,10 +332,12 @@
       bool     clearPowerFail();
       DateTime getPowerDown();
       DateTime getPowerUp();
-	  int8_t   calibrateOrAdjust(const DateTime& dt);
-	  int32_t  getPPMDeviation(const DateTime& dt);
-	  void     setSetUnixTime(uint32_t aTime);
-	  uint32_t getSetUnixTime();
+      int8_t   calibrateOrAdjust(const DateTime& dt);
+      int32_t  getPPMDeviation(const DateTime& dt);
+      void     setSetUnixTime(uint32_t aTime);
+      uint32_t getSetUnixTime();
+      void     setRegisterShadow(const bool state);
+      void     invalidateRegisters();
 /*******************************************************************************************************************
 ** Declare the readRAM() and writeRAM() methods as template functions to use for all I2C device I/O. The code has **
 ** to be in the main library definition rather than the actual MCP7940.cpp library file.The template functions    **
@@ -280,35 +346,28 @@
 ** The MCP7940 supports 64 bytes of general purpose SRAM memory, which can be used to store data. For more        **
 ** details, see datasheet page 36.                                                                                **
 **                                                                                                                **
-** The data is stored in a block of 64 bytes, reading beyond the end of the block causes the address pointer to   **
-** roll over to the start of the block.                                                                           **
+** The data is stored in a block of 64 bytes, reading or writing beyond the end of the block rolls over to the    **
+** start of the block. The templates hand the bytes to the readRAM()/writeRAM() block functions, which split the  **
+** transfer into Wire buffer sized transactions.                                                                  **
+**                                                                                                                **
+** Bytes 56 to 63 (MCP7940_CAL_RAM_ADDR) hold the calibration record once calibrate(), calibrateOrAdjust() or     **
+** setSetUnixTime() have been used, and adjust() then restarts it. They are only written when the trim or the     **
+** reference time changes, but sketches using calibration should keep their own data in bytes 0 to 55.            **
 *******************************************************************************************************************/
-
+      uint8_t  readRAM(const uint8_t addr, uint8_t* data, const uint8_t len);
+      uint8_t  writeRAM(const uint8_t addr, const uint8_t* data, const uint8_t len);
 /***************************************************************************************************************//*!
 * @brief     Template for readRAM()
 * @details   As a template it can support compile-time data type definitions
 * @param[in] addr Memory address
 * @param[in] value    Data Type "T" to read
-* @return    Pointer to return data structure
+* @return    Number of bytes read
 *******************************************************************************************************************/
       template< typename T >
-      uint8_t&  readRAM(const uint8_t addr, T &value) 
+      uint8_t readRAM(const uint8_t addr, T &value) 
       {
-        uint8_t* bytePtr    = (uint8_t*)&value;            // Pointer to structure beginning
-        uint8_t  structSize = sizeof(T);                   // Number of bytes in structure
-        uint8_t  i         = 0;                            // loop counter
-        Wire.beginTransmission(MCP7940_ADDRESS);           // Address the I2C device
-        Wire.write((addr%64) + MCP7940_RAM_ADDRESS);       // Send register address to write
-        _TransmissionStatus = Wire.endTransmission();      // Close transmission
-        for (i=0;i<structSize;i++)                         // loop for each byte to be read
-        {
-          if (i%BUFFER_LENGTH==0)                          // loop for each buffer block
-          { 
-            Wire.requestFrom(MCP7940_ADDRESS, structSize); // Request a block of data
-          } // of if-then we are at a buffer boundary
-          *bytePtr++ = Wire.read(); // next byte
-        } // of for-next each byte to be read
-        return (i);
+        static_assert(sizeof(T) <= MCP7940_RAM_SIZE, "Type does not fit in the MCP7940 SRAM");
+        return readRAM(addr, (uint8_t*)&value, sizeof(T));
       } // of method readRAM()
 /***************************************************************************************************************//*!
 * @brief     Template for writeRAM()
@@ -320,31 +379,47 @@
       template<typename T>
       bool writeRAM(const uint8_t addr, const T &value) 
       {
-        const uint8_t* bytePtr = (const uint8_t*)&value; // Pointer to structure beginning
-        Wire.beginTransmission(MCP7940_ADDRESS);         // Address the I2C device
-        Wire.write((addr%64) + MCP7940_RAM_ADDRESS);     // Send register address to write
-        for (uint8_t i = 0; i < sizeof(T); i++)          // loop for each byte to be written
-        {
-          Wire.write(*bytePtr++);
-        } // of for-next each byte
-        _TransmissionStatus = Wire.endTransmission();    // Close transmission
-        return (!_TransmissionStatus);                   // return error status
+        static_assert(sizeof(T) <= MCP7940_RAM_SIZE, "Type does not fit in the MCP7940 SRAM");
+        return writeRAM(addr, (const uint8_t*)&value, sizeof(T)) == sizeof(T);
       } // of method writeRAM()
     private:
+      struct CalibrationRecord                                       ///< Kept at MCP7940_CAL_RAM_ADDR
+      {
+        uint8_t  magic;                                              ///< MCP7940_CAL_MAGIC when valid
+        uint32_t reference;                                          ///< UNIX time drift is measured from
+        int16_t  stepped;                                            ///< Seconds gained and set back since
+        int8_t   lastStep;                                           ///< Trim change of the last calibration
+      } __attribute__((packed)); // of struct CalibrationRecord
       uint8_t  readByte(const uint8_t addr);                         // Read 1 byte from address on I2C
       void     writeByte(const uint8_t addr, const uint8_t data);    // Write 1 byte at address to I2C
+      void     writeBlock(const uint8_t addr, const uint8_t* data,   // Write consecutive registers in
+                          const uint8_t len);                        // one burst
+      uint8_t  readBlock(const uint8_t addr, uint8_t* data,          // Read consecutive registers in
+                         const uint8_t len);                         // one burst
+      bool     waitForOscillator(const bool state);                  // Poll OSCRUN until it matches state
+      void     setTime(const DateTime& dt);                          // Write the timekeeping registers
+      void     writeTrim(const int8_t trim);                         // Write OSCTRIM in fine trim mode
+      int32_t  calibrationSpan(const DateTime& dt,                   // Read the record, seconds since the
+                               CalibrationRecord& record,            // reference and seconds gained
+                               int32_t& gained);                     //
+      void     holdReference(const DateTime& dt,                     // Correct the time, keep the drift
+                             CalibrationRecord& record,              // reference
+                             const int32_t gained);                  //
+      void     startReference(const DateTime& dt,                    // New drift reference in SRAM
+                              const int8_t lastStep);                //
+      int8_t   shadowIndex(const uint8_t reg);                       // Shadow slot for register or -1
+      void     updateShadow(const uint8_t reg, const uint8_t data);  // Store value if register shadowed
+      void     invalidateHardwareBits(const uint8_t reg,             // Drop shadow if bits are device
+                                      const uint8_t bits);           // owned
+      uint8_t  readForWrite(const uint8_t reg);                      // Register with live device bits
       uint8_t  bcd2int(const uint8_t bcd);                           // convert BCD digits to integer
       uint8_t  int2bcd(const uint8_t dec);                           // convert integer to BCD
       uint8_t  _TransmissionStatus = 0;                              ///< Status of I2C transmission
       bool     _CrystalStatus     = false;                           ///< True if RTC is turned on
       bool     _OscillatorStatus  = false;                           ///< True if Oscillator on and working
-      uint32_t _SetUnixTime       = 0;                               ///< UNIX time when clock last set
-      uint8_t  _ss,                                                  ///< Time component Seconds
-               _mm,                                                  ///< Time component Minutes
-               _hh,                                                  ///< Time component Hours
-               _d,                                                   ///< Time component Days
-               _m;                                                   ///< Time component Months
-      uint16_t _y;                                                   ///< Time component Years
+      bool     _ShadowEnabled     = false;                           ///< True if registers are shadowed
+      uint8_t  _ShadowValid       = 0;                               ///< Bit per shadow slot, set if cached
+      uint8_t  _Shadow[MCP7940_SHADOW_REGISTERS];                    ///< Shadow copies of registers
       void     clearRegisterBit(const uint8_t reg, const uint8_t b); // Clear a bit, values 0-7
       void     setRegisterBit  (const uint8_t reg, const uint8_t b); // Set   a bit, values 0-7
       void     writeRegisterBit(const uint8_t reg, const uint8_t b,  // Clear a bit, values 0-7
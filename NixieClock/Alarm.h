@@ -0,0 +1,116 @@
+/*
+ * Nixie Clock Project
+ * Daily alarm kept in the MCP7940 alarm registers
+ *
+ * An MCP7940 alarm only compares one field of the time (or all of them, date included), so a daily alarm uses ALM0
+ * matching the minute with the hour kept in ALM0HOUR, where the RTC ignores it. With ALMPOL set the MFP pin goes high
+ * while ALM0IF is set, service() clears the flag after the interrupt and checks the hour against the time, so the
+ * alarm goes off however the hour was reached: set within its own hour or after a reset in it. That is one interrupt
+ * an hour and no bus traffic in between.
+ *
+ * When the MFP pin is carrying the 1Hz square wave it can't signal alarms, so check() runs the same match against the
+ * time the sketch is already counting. alarmMatches() is the match the RTC makes, one case per ALMxMSK setting.
+ *
+ * Either way the alarm goes off once a day: the day of the month it went off is kept, and changing the alarm clears it.
+ *
+ * The registers are the only copy of the alarm, load() reads it back after reset.
+ */
+
+#ifndef Alarm_h
+#define Alarm_h
+
+#include <Arduino.h>
+#include <MCP7940.h>
+
+// Alarm types, the ALMxMSK bits
+#define ALARM_MATCH_SECOND  0
+#define ALARM_MATCH_MINUTE  1
+#define ALARM_MATCH_HOUR    2
+#define ALARM_MATCH_WEEKDAY 3
+#define ALARM_MATCH_DATE    4     // Day of the month
+#define ALARM_MATCH_ALL     7     // Second, minute, hour, weekday, date and month. 5 and 6 are reserved
+
+//True if time matches alarm in the fields an alarm of this type compares, the same test the RTC makes each second
+inline bool alarmMatches(uint8_t type, const DateTime& alarm, const DateTime& time) {
+  switch(type) {
+    case ALARM_MATCH_SECOND:
+      return time.second() == alarm.second();
+    case ALARM_MATCH_MINUTE:
+      return time.minute() == alarm.minute();
+    case ALARM_MATCH_HOUR:
+      return time.hour() == alarm.hour();
+    case ALARM_MATCH_WEEKDAY:
+      return time.dayOfTheWeek() == alarm.dayOfTheWeek();
+    case ALARM_MATCH_DATE:
+      return time.day() == alarm.day();
+    case ALARM_MATCH_ALL:
+      return time.second() == alarm.second() && time.minute() == alarm.minute() && time.hour() == alarm.hour() &&
+             time.dayOfTheWeek() == alarm.dayOfTheWeek() && time.day() == alarm.day() && time.month() == alarm.month();
+    default:
+      return false;
+  }
+}
+
+class DailyAlarm {
+  public:
+    //Reads the alarm back from ALM0, it is only on if ALM0 is enabled and matching the minute
+    void load(MCP7940_Class& rtc) {
+      uint8_t type;
+      DateTime alarm = rtc.getAlarm(0, type);
+      _time = DateTime(2000, 1, 1, alarm.hour() < 24 ? alarm.hour() : 0, alarm.minute() < 60 ? alarm.minute() : 0);
+      _on = type == ALARM_MATCH_MINUTE && rtc.getAlarmState(0);
+      _rangDay = 0;
+    }
+
+    //Writes the alarm to ALM0, enabled while it is on. ALM1 isn't used, it is turned off in case an older sketch left
+    //it matching the hour
+    void save(MCP7940_Class& rtc) {
+      rtc.setAlarm(0, ALARM_MATCH_MINUTE, _time, _on);
+      rtc.setAlarmState(1, false);
+    }
+
+    //Clears the flag after an MFP interrupt, returns true if the alarm should go off. ALM0 matched the minute, the
+    //hour is checked against time, which has to be the RTC's time
+    bool service(MCP7940_Class& rtc, const DateTime& time) {
+      if(!rtc.isAlarm(0))
+        return false;
+      rtc.clearAlarm(0);
+      return check(time);
+    }
+
+    //Matches the alarm against a time, returns true the first time it matches each day
+    bool check(const DateTime& time) {
+      if(!_on || !alarmMatches(ALARM_MATCH_HOUR, _time, time) || !alarmMatches(ALARM_MATCH_MINUTE, _time, time))
+        return false;
+      if(time.day() == _rangDay)
+        return false;
+      _rangDay = time.day();
+      return true;
+    }
+
+    //Steps the hour or minute, wrapping within the field
+    void adjust(uint8_t field, int8_t delta) {
+      _time.adjustField(field, delta);
+      _rangDay = 0;
+    }
+
+    void setOn(bool on) {
+      _on = on;
+      _rangDay = 0;
+    }
+
+    bool on() const {
+      return _on;
+    }
+
+    const DateTime& time() const {
+      return _time;
+    }
+
+  private:
+    DateTime _time = DateTime(2000, 1, 1);  // Only the hour and minute are used
+    bool _on = false;
+    uint8_t _rangDay = 0;         // Day of the month the alarm last went off, 0 if it hasn't since being changed
+};
+
+#endif
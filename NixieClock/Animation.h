@@ -0,0 +1,121 @@
+/*
+ * Nixie Clock Project
+ * Time based tweens for fades, pulses and colour transitions
+ *
+ * A tween moves an 8 bit value between two end points over a fixed number of milliseconds. Its value depends only
+ * on how long ago it was started, never on how often it is updated, so the same sequence of times always gives the
+ * same frames no matter how long the rest of loop() takes. Tweens never read the clock themselves, the caller passes
+ * the time to start() and update().
+ *
+ * Easing curves are 17 point lookup tables in flash, indexed by the top 4 bits of the progress and linearly
+ * interpolated with the bottom 4 bits.
+ */
+
+#ifndef Animation_h
+#define Animation_h
+
+#include <Arduino.h>
+
+// Easing curves
+#define EASE_LINEAR       0
+#define EASE_IN_OUT       1     // Smoothstep, slow at both ends
+#define EASE_SINE         2     // Half a cosine, same shape as the FastLED beatsin8() waves
+#define EASE_CURVES       3
+#define EASE_POINTS       17
+
+// Tween modes
+#define TWEEN_ONCE        0     // Stops at the end value and calls the done function
+#define TWEEN_PINGPONG    1     // Runs back and forth between the end values until stopped
+
+const uint8_t easeTable[EASE_CURVES][EASE_POINTS] PROGMEM = {
+  {   0,  16,  32,  48,  64,  80,  96, 112, 128, 143, 159, 175, 191, 207, 223, 239, 255 },
+  {   0,   3,  11,  24,  40,  59,  81, 104, 128, 151, 174, 196, 215, 231, 244, 252, 255 },
+  {   0,   2,  10,  21,  37,  57,  79, 103, 127, 152, 176, 198, 218, 234, 245, 253, 255 }
+};
+
+typedef void (*TweenDone)();
+
+//Applies an easing curve to a progress value, 0-255 in and out
+inline uint8_t ease8(uint8_t curve, uint8_t progress) {
+  const uint8_t* table = easeTable[curve] + (progress >> 4);
+  uint8_t a = pgm_read_byte(table);
+  uint8_t b = pgm_read_byte(table + 1);
+  return a + (((uint16_t)(b - a) * (progress & 0x0F)) >> 4);
+}
+
+class Tween {
+  public:
+    //Starts moving from one value to another over duration ms from the time now
+    void start(unsigned long now, uint8_t from, uint8_t to, uint16_t duration, uint8_t curve = EASE_LINEAR,
+               uint8_t mode = TWEEN_ONCE, TweenDone done = NULL) {
+      _start = now;
+      _from = from;
+      _to = to;
+      _duration = duration ? duration : 1;
+      _curve = curve;
+      _mode = mode;
+      _done = done;
+      _value = from;
+      _active = true;
+    }
+
+    //Stops and holds a value
+    void set(uint8_t value) {
+      _value = value;
+      _active = false;
+      _done = NULL;
+    }
+
+    //Stops where it is without calling the done function
+    void stop() {
+      _active = false;
+      _done = NULL;
+    }
+
+    bool active() const {
+      return _active;
+    }
+
+    uint8_t value() const {
+      return _value;
+    }
+
+    //Recomputes the value for the given time, returns true if the tween was running. A finished TWEEN_ONCE tween
+    //lands exactly on its end value and then calls its done function, which may start it again
+    bool update(unsigned long now) {
+      if(!_active)
+        return false;
+      unsigned long elapsed = now - _start;
+      bool reverse = false;
+      if(_mode == TWEEN_PINGPONG) {
+        reverse = (elapsed / _duration) & 1;
+        elapsed %= _duration;
+      } else if(elapsed >= _duration) {
+        _value = _to;
+        _active = false;
+        TweenDone done = _done;
+        _done = NULL;
+        if(done)
+          done();
+        return true;
+      }
+      uint8_t progress = (elapsed << 8) / _duration;
+      uint8_t eased = ease8(_curve, reverse ? 255 - progress : progress);
+      int16_t span = (int16_t)_to - _from;
+      _value = _from + (((int32_t)span * (eased + (eased >> 7))) >> 8);
+      return true;
+    }
+
+  private:
+    unsigned long _start = 0;
+    uint16_t _duration = 1;
+    uint8_t _from = 0;
+    uint8_t _to = 0;
+    uint8_t _value = 0;
+    uint8_t _curve = EASE_LINEAR;
+    uint8_t _mode = TWEEN_ONCE;
+    bool _active = false;
+    TweenDone _done = NULL;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Nixie Clock Project
+ * Interrupt driven push buttons
+ *
+ * The pin change interrupts call sample(), which only records which buttons are down and when, in a small ring of
+ * edges. update() runs from a task and works through those edges in order, so a press and release that both happen
+ * during one slow frame are still seen. Each button is debounced by taking the first edge and ignoring the contacts
+ * for DEBOUNCE_TIME afterwards.
+ *
+ * Debounced changes come out of read() as events: press and release, then either a short press on release or a long
+ * press once it has been held for LONG_PRESS_TIME. Buttons attached with BUTTON_REPEAT send repeat events while held,
+ * getting faster the longer they are held.
+ *
+ * Buttons are active high.
+ */
+
+#ifndef Buttons_h
+#define Buttons_h
+
+#include <Arduino.h>
+
+#define DEBOUNCE_TIME     20    // ms the contacts are ignored after an accepted edge
+#define LONG_PRESS_TIME   500   // ms held before a long press, released earlier is a short press
+#define REPEAT_DELAY      400   // ms held before the first repeat
+#define REPEAT_START      200   // ms between the first repeats
+#define REPEAT_MIN        20    // ms between repeats once fully accelerated
+#define REPEAT_SHIFT      2     // Each repeat comes 1/4 sooner than the last
+
+#define EDGE_QUEUE        8     // Raw edges the interrupt can store between updates, must be a power of 2
+#define EVENT_QUEUE       8     // Events waiting to be read, must be a power of 2
+
+// Button options
+#define BUTTON_PLAIN      0
+#define BUTTON_REPEAT     1     // Send repeat events while held
+
+// Event types
+#define BUTTON_PRESS      0     // Went down
+#define BUTTON_RELEASE    1     // Came up, always after a press
+#define BUTTON_SHORT      2     // Came up before it became a long press
+#define BUTTON_LONG       3     // Held for LONG_PRESS_TIME, sent once per press
+#define BUTTON_HELD       4     // Repeat while held, BUTTON_REPEAT buttons only
+
+struct ButtonEvent {
+  uint8_t button;               // Index given to attach()
+  uint8_t type;
+  unsigned long time;           // millis() when it happened
+};
+
+template<uint8_t COUNT>
+class Buttons {
+  public:
+    //Sets up a button and enables the pin change interrupt for its pin. The sketch provides the ISR for the port
+    void attach(uint8_t index, uint8_t pin, uint8_t options = BUTTON_PLAIN) {
+      pinMode(pin, INPUT);
+      _port[index] = portInputRegister(digitalPinToPort(pin));
+      _mask[index] = digitalPinToBitMask(pin);
+      if(options & BUTTON_REPEAT)
+        _repeats |= bit(index);
+      uint8_t oldSREG = SREG;
+      cli();
+      *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+      *digitalPinToPCICR(pin) |= bit(digitalPinToPCICRbit(pin));
+      _levels = readLevels();
+      _stable = _levels;
+      SREG = oldSREG;
+    }
+
+    //Records the button levels if they changed, call from the pin change ISRs
+    void sample() {
+      uint8_t levels = readLevels();
+      if(levels == _levels)
+        return; //Another pin on the same port
+      _levels = levels;
+      uint8_t next = (_edgeHead + 1) & (EDGE_QUEUE - 1);
+      if(next == _edgeTail)
+        return; //Full, update() still catches up from the current levels
+      _edges[_edgeHead].levels = levels;
+      _edges[_edgeHead].time = millis();
+      _edgeHead = next;
+    }
+
+    //Debounces the recorded edges and queues events, call often from a task
+    void update() {
+      unsigned long now = millis();
+      while(_edgeTail != _edgeHead) {
+        Edge edge = _edges[_edgeTail];
+        _edgeTail = (_edgeTail + 1) & (EDGE_QUEUE - 1);
+        apply(edge.levels, now - (uint16_t)((uint16_t)now - edge.time));
+      }
+      apply(_levels, now); //Settles anything whose last edge was inside the debounce time
+
+      for(uint8_t i=0;i<COUNT;i++) {
+        if(!(_stable & bit(i)))
+          continue;
+        unsigned long held = now - _pressTime[i];
+        if(!(_longSent & bit(i)) && held >= LONG_PRESS_TIME) {
+          _longSent |= bit(i);
+          push(i, BUTTON_LONG, _pressTime[i] + LONG_PRESS_TIME);
+        }
+        if((_repeats & bit(i)) && (long)(now - _nextRepeat[i]) >= 0) {
+          push(i, BUTTON_HELD, now);
+          _nextRepeat[i] = now + _repeatInterval[i];
+          _repeatInterval[i] -= _repeatInterval[i] >> REPEAT_SHIFT;
+          if(_repeatInterval[i] < REPEAT_MIN)
+            _repeatInterval[i] = REPEAT_MIN;
+        }
+      }
+    }
+
+    //Takes the oldest event, returns false if there are none
+    bool read(ButtonEvent &event) {
+      if(_eventTail == _eventHead)
+        return false;
+      event = _events[_eventTail];
+      _eventTail = (_eventTail + 1) & (EVENT_QUEUE - 1);
+      return true;
+    }
+
+    //Debounced state of a button
+    bool isDown(uint8_t index) {
+      return _stable & bit(index);
+    }
+
+    //True while a button is down or its edges haven't been debounced yet, millis() has to keep running until then
+    bool busy() {
+      return _levels || _stable || _edgeTail != _edgeHead;
+    }
+
+  private:
+    struct Edge {
+      uint8_t levels;           // Bit per button, set if down
+      uint16_t time;            // Low 16 bits of millis()
+    };
+
+    volatile uint8_t* _port[COUNT];
+    uint8_t _mask[COUNT];
+    uint8_t _repeats = 0;       // Bit per button attached with BUTTON_REPEAT
+
+    volatile uint8_t _levels = 0;         // Last levels seen by sample()
+    Edge _edges[EDGE_QUEUE];
+    volatile uint8_t _edgeHead = 0;       // Written by the ISR
+    uint8_t _edgeTail = 0;                // Written by update()
+
+    uint8_t _stable = 0;                  // Debounced levels
+    uint8_t _longSent = 0;                // Bit per button, long press already sent for this press
+    uint16_t _lastEdge[COUNT];            // Low 16 bits of millis() at the last accepted edge
+    unsigned long _pressTime[COUNT];
+    unsigned long _nextRepeat[COUNT];
+    uint16_t _repeatInterval[COUNT];
+
+    ButtonEvent _events[EVENT_QUEUE];
+    uint8_t _eventHead = 0;
+    uint8_t _eventTail = 0;
+
+    uint8_t readLevels() {
+      uint8_t levels = 0;
+      for(uint8_t i=0;i<COUNT;i++) {
+        if(_port[i] && (*_port[i] & _mask[i]))
+          levels |= bit(i);
+      }
+      return levels;
+    }
+
+    //Accepts any change in levels for buttons that are outside their debounce time
+    void apply(uint8_t levels, unsigned long time) {
+      uint8_t changed = levels ^ _stable;
+      for(uint8_t i=0;i<COUNT;i++) {
+        if(!(changed & bit(i)) || (uint16_t)((uint16_t)time - _lastEdge[i]) < DEBOUNCE_TIME)
+          continue;
+        _lastEdge[i] = time;
+        _stable ^= bit(i);
+        if(levels & bit(i)) {
+          _pressTime[i] = time;
+          _longSent &= ~bit(i);
+          _nextRepeat[i] = time + REPEAT_DELAY;
+          _repeatInterval[i] = REPEAT_START;
+          push(i, BUTTON_PRESS, time);
+        } else {
+          if(!(_longSent & bit(i)))
+            push(i, time - _pressTime[i] >= LONG_PRESS_TIME ? BUTTON_LONG : BUTTON_SHORT, time); //Whole press in one stall
+          push(i, BUTTON_RELEASE, time);
+        }
+      }
+    }
+
+    //Queues an event, the oldest is dropped if nobody is reading them
+    void push(uint8_t button, uint8_t type, unsigned long time) {
+      uint8_t next = (_eventHead + 1) & (EVENT_QUEUE - 1);
+      if(next == _eventTail)
+        _eventTail = (_eventTail + 1) & (EVENT_QUEUE - 1);
+      _events[_eventHead].button = button;
+      _events[_eventHead].type = type;
+      _events[_eventHead].time = time;
+      _eventHead = next;
+    }
+};
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Nixie Clock Project
+ * Clap detector on the audio ADC input
+ *
+ * The ADC free-runs at about 9.6kHz and interrupts on every conversion. The ISR removes the DC bias and keeps the
+ * largest deviation of every 8 conversions, so the ring buffer fills at about 1.2kHz and covers a few frames of
+ * interrupts being held off by FastLED.
+ *
+ * update() runs the buffered peaks through a fixed point envelope follower with a fast attack and a short release. A
+ * slow noise floor follows the envelope while it is quiet. A clap is the envelope going well above the floor within
+ * CLAP_MAX_RISE of passing half way there, and coming back down within CLAP_MAX_LENGTH. Anything that builds up more
+ * slowly (a syllable) or stays loud for longer (music, a door slam rumbling) is not a clap and cancels the pattern in
+ * progress. Claps CLAP_MIN_GAP to CLAP_MAX_GAP apart make a pattern, which is
+ * reported once the room has been quiet for CLAP_MAX_GAP.
+ *
+ * All times are counted in decimated samples so the detector behaves the same whatever else is running.
+ */
+
+#ifndef Clap_h
+#define Clap_h
+
+#include <Arduino.h>
+
+#define CLAP_DECIMATE       8     // ADC conversions per buffered peak
+#define CLAP_SAMPLES(ms)    ((uint16_t)((ms) * 6UL / 5)) // 16MHz / 128 / 13 / CLAP_DECIMATE is ~1.2 samples per ms
+#define CLAP_BUFFER         32    // Buffered peaks, must be a power of 2
+#define CLAP_BIAS_SHIFT     10    // DC bias follows the input with a ~0.1s time constant
+#define CLAP_ATTACK_SHIFT   1     // Envelope moves half way to a louder peak each sample
+#define CLAP_RELEASE_SHIFT  4     // and 1/16 of the way to a quieter one, ~13ms
+#define CLAP_RISE_SHIFT     9     // Noise floor creeps up over ~0.4s
+#define CLAP_FALL_SHIFT     5     // and drops back over ~25ms
+#define CLAP_RATIO          4     // A clap is this many times the noise floor
+#define CLAP_MIN_LEVEL      24    // plus this much, so silence doesn't make every tap a clap
+#define CLAP_MAX_RISE       CLAP_SAMPLES(5)
+#define CLAP_MAX_LENGTH     CLAP_SAMPLES(80)
+#define CLAP_MIN_GAP        CLAP_SAMPLES(150)
+#define CLAP_MAX_GAP        CLAP_SAMPLES(800)
+#define CLAP_MAX_PATTERN    3     // Longer runs of claps are ignored
+
+class ClapDetector {
+  public:
+    //Starts the ADC free-running on an analog pin, the sketch provides ISR(ADC_vect) calling sample(ADCH)
+    void begin(uint8_t pin) {
+      uint8_t channel = pin >= A0 ? pin - A0 : pin;
+      ADMUX = bit(REFS0) | bit(ADLAR) | (channel & 0x07);  // AVcc reference, 8 bit result in ADCH
+      ADCSRB = 0;                                            // Free running
+      if(channel < 6)
+        DIDR0 |= bit(channel);                               // Digital input buffer off
+      ADCSRA = bit(ADEN) | bit(ADSC) | bit(ADATE) | bit(ADIE) | bit(ADPS2) | bit(ADPS1) | bit(ADPS0);
+    }
+
+    //Stops the ADC and its interrupt, begin() starts it again
+    void stop() {
+      ADCSRA = 0;
+    }
+
+    //Takes one conversion, call from the ADC ISR
+    void sample(uint8_t value) {
+      _bias += (int16_t)(((uint16_t)value << 7) - (_bias >> 1)) >> (CLAP_BIAS_SHIFT - 1); //Halved to stay in 16 bits
+      uint8_t bias = _bias >> 8;
+      uint8_t deviation = value > bias ? value - bias : bias - value;
+      if(deviation > _peak)
+        _peak = deviation;
+      if(++_decimate < CLAP_DECIMATE)
+        return;
+      _decimate = 0;
+      uint8_t next = (_head + 1) & (CLAP_BUFFER - 1);
+      if(next != _tail) {
+        _buffer[_head] = _peak;
+        _head = next;
+      }
+      _peak = 0;
+    }
+
+    //Works through the buffered samples, returns the number of claps once a pattern has finished, otherwise 0
+    uint8_t update() {
+      uint8_t claps = 0;
+      while(_tail != _head) {
+        uint8_t peak = _buffer[_tail];
+        _tail = (_tail + 1) & (CLAP_BUFFER - 1);
+        uint8_t found = process(peak);
+        if(found)
+          claps = found;
+      }
+      return claps;
+    }
+
+    //Forgets any claps in progress, for when the sketch isn't listening
+    void reset() {
+      _claps = 0;
+    }
+
+    uint8_t envelope() {
+      return _envelope >> 8;
+    }
+
+    uint8_t noiseFloor() {
+      return _floor >> 8;
+    }
+
+    //Runs one decimated peak through the detector, returns the number of claps if a pattern just finished
+    uint8_t process(uint8_t peak) {
+      _count++;
+      uint16_t level = (uint16_t)peak << 8;
+      if(level > _envelope)
+        _envelope += (level - _envelope) >> CLAP_ATTACK_SHIFT;
+      else
+        _envelope -= (_envelope - level) >> CLAP_RELEASE_SHIFT;
+
+      uint16_t threshold = (_floor >> 8) * CLAP_RATIO + CLAP_MIN_LEVEL;
+      uint8_t env = _envelope >> 8;
+      if(!_loud) {
+        if(_envelope > _floor)
+          _floor += (_envelope - _floor) >> CLAP_RISE_SHIFT;
+        else
+          _floor -= (_floor - _envelope) >> CLAP_FALL_SHIFT;
+        if(env <= (threshold >> 1))
+          _riseStart = _count;                  //Still quiet, a rise is timed from the last sample here
+        if(env > threshold) {
+          _loud = true;
+          _loudStart = _count;
+          _sharp = (uint16_t)(_count - _riseStart) <= CLAP_MAX_RISE;
+        }
+      } else if(env < threshold - (threshold >> 2)) { //A quarter of hysteresis so the tail doesn't retrigger
+        _loud = false;
+        if(_sharp && (uint16_t)(_count - _loudStart) <= CLAP_MAX_LENGTH)
+          clap(_loudStart);
+        else
+          _claps = 0;
+      }
+
+      if(_claps && !_loud && (uint16_t)(_count - _lastClap) > CLAP_MAX_GAP) {
+        uint8_t claps = _claps;
+        _claps = 0;
+        if(claps >= 2 && claps <= CLAP_MAX_PATTERN)
+          return claps;
+      }
+      return 0;
+    }
+
+  private:
+    volatile uint16_t _bias = 128 << 8;   // 8.8 fixed point, ISR only
+    volatile uint8_t _peak = 0;           // ISR only
+    volatile uint8_t _decimate = 0;       // ISR only
+    volatile uint8_t _buffer[CLAP_BUFFER];
+    volatile uint8_t _head = 0;           // Written by the ISR
+    uint8_t _tail = 0;                    // Written by update()
+
+    uint16_t _count = 0;                  // Samples processed, wraps every ~54s which is fine for the gaps here
+    uint16_t _envelope = 0;               // 8.8 fixed point
+    uint16_t _floor = 0;                  // 8.8 fixed point
+    bool _loud = false;
+    bool _sharp = false;                  // The loud part rose fast enough to be a clap
+    uint16_t _riseStart = 0;              // Last quiet sample, below half the threshold
+    uint16_t _loudStart = 0;
+    uint8_t _claps = 0;                   // Claps in the pattern so far
+    uint16_t _lastClap = 0;
+
+    void clap(uint16_t time) {
+      uint16_t gap = time - _lastClap;
+      if(_claps == 0 || gap > CLAP_MAX_GAP)
+        _claps = 1;
+      else if(gap < CLAP_MIN_GAP)
+        return; //Echo or a double hit, counts as the same clap
+      else if(_claps <= CLAP_MAX_PATTERN)
+        _claps++;
+      _lastClap = time;
+    }
+};
+
+#endif
@@ -11,7 +11,17 @@
 #include <TTSi7006.h>
 #include <FastLED.h>
 #include <MCP7940.h>
+#include <TempGradient.h>
+#include <TubeDisplay.h>
 #include <math.h>
+#include <avr/sleep.h>
+#include "Scheduler.h"
+#include "Animation.h"
+#include "Buttons.h"
+#include "Clap.h"
+#include "Palette.h"
+#include "Trace.h"
+#include "Alarm.h"
 
 //constants
 //const uint32_t  BAUD_RATE     = 115200;
@@ -30,11 +40,29 @@
 #define SW_MODE_PIN       9
 #define AUD_ADC_PIN       A0
 #define ATHRESH_PIN       3
-#define SHORT_PRESS_TIME  500 //ms
-#define UPDOWN_COOLDOWN   200 //ms
 #define CLAP_MIN_TIME     200 //ms
 #define CLAP_MAX_TIME     800 //ms
+#define CLAP_ADC          1     // 1 = find claps in the audio on AUD_ADC_PIN, 0 = edges from the peak detector on ATHRESH_PIN
 #define SET_TIMEOUT       30000 // 30s timeout if no activity
+#define RTC_MFP_PIN       2     // MCP7940 MFP output (open drain), INT0
+#define RTC_SQW_TIMEBASE  1     // 1 = count the 1Hz square wave from the MFP pin, 0 = poll MCP7940.now() every loop
+                                // and take alarm interrupts on the MFP pin instead
+#define RTC_SYNC_PERIOD   600   // s between full re-reads of the RTC when counting the square wave
+#define RTC_TICK_TIMEOUT  2000  // ms without a square wave edge before falling back to polling
+#define BOOT_RETRY_PERIOD 250   // ms between attempts to bring up the RTC after reset
+#define BOOT_RTC_TRIES    12    // Attempts before running without the RTC
+#define RTC_RETRY_PERIOD  60000 // ms between attempts to find the RTC while running without it
+#define OSC_POLL_PERIOD   10    // ms between OSCRUN checks while the RTC oscillator starts
+#define OSC_POLL_TRIES    100   // Checks before giving up on the oscillator, a second as nothing waits on it
+#define OVERRUN_TIME      2000  // us, a scheduler pass longer than INPUT_PERIOD holds up the buttons
+#define ALARM_RING_TIME   60000 // ms the alarm pulses the tubes before giving up
+#define ALARM_SNOOZE_TIME 540000 // ms a clap snoozes the alarm for
+#define ALARM_CLAP_SNOOZE 1     // 1 = a double or triple clap snoozes the alarm, 0 = only a button stops it
+#define NIGHT_START       23    // Hour the tubes go dark and the MCU sleeps between interrupts
+#define NIGHT_END         7     // Hour they come back, the same as NIGHT_START for no night mode
+#define NIGHT_BRIGHTNESS  0     // 0 blanks the tubes at night, anything else dims them to this
+#define NIGHT_WAKE_TIME   30000 // ms a button or clap lights the tubes for at night
+#define NIGHT_POWER_DOWN  1     // 1 = power down between square wave ticks while blank, 0 = only idle sleep
 
 // Non numerical LED locations
 //#define TEMP_SYMB       0 //needs updating
@@ -49,8 +77,7 @@
 //Trim value set to -180 clock cycles every minute
 
 
-#define NUM_LEDS          10
-#define NUM_STRIPS        6
+#define NUM_LEDS          10    // LEDs behind each tube
 
 #define DIN_L1_PIN        6 // Which pin this is hooked up to
 #define DIN_L1            0 // Index in the array of where this is kept
@@ -74,68 +101,273 @@
 #define COLOR_ORDER       GRB
 #define MAX_BRIGHTNESS        255
 
-// Define the 2D array of LEDs and strips
-CRGB leds[NUM_STRIPS][NUM_LEDS];
-
-const uint8_t  SPRINTF_BUFFER_SIZE =     32;                                  // Buffer size for sprintf()        //
+// The tubes in DIN_* index order, each on its own data line. Define TUBE_CHAIN_PIN to drive them daisy chained
+// from one pin instead
+//#define TUBE_CHAIN_PIN  6
+#ifdef TUBE_CHAIN_PIN
+typedef TubeChain<LED_TYPE, COLOR_ORDER, NUM_LEDS, nullptr, 6, TUBE_CHAIN_PIN> Tubes;
+#define RAM_TUBES         256   // SRAM budget, a chain needs LEDs for every tube
+#else
+typedef TubeStrips<LED_TYPE, COLOR_ORDER, NUM_LEDS, nullptr,
+                   DIN_L1_PIN, DIN_L2_PIN, DIN1_PIN, DIN2_PIN, DIN_R1_PIN, DIN_R2_PIN> Tubes;
+#define RAM_TUBES         104   // SRAM budget, the strips share one tube's worth of LEDs
+#endif
+#define NUM_TUBES         Tubes::TUBES
+
+Tubes tubes;                    // Display list, a digit and a palette index per tube
+uint8_t tubeTheme[NUM_TUBES];   // Palette entry each tube is drawn in
+
+unsigned long framesRendered = 0;  // Frames where at least one strip was pushed
+unsigned long framesSkipped  = 0;  // Frames where nothing changed and no strip was pushed
 
 //variables
-bool lastStateSET       = LOW;  // the previous state from the SET pin
-bool lastStateMODE      = LOW;  // the previous state from the MODE pin
 bool lastStateATHRESH   = LOW;  // the previous state from the ATHRESH pin
-bool currentStateSET;           // the current reading from the SET pin
-bool currentStateMODE;           // the current reading from the SET pin
 bool currentStateATHRESH;       // the current reading from the ATHRESH pin
-unsigned long pressedTimeSET   = 0;
-unsigned long releasedTimeSET = 0;
 unsigned long lastClap    = 0;
 unsigned long currentClap = 0;
-unsigned long lastUPDOWN = 0;
 int setTimeIndex = 0;
-
-char          inputBuffer[SPRINTF_BUFFER_SIZE];                               // Buffer for sprintf()/sscanf()    //
+// DateTime field the UP/DOWN buttons change for each setTimeIndex: hour, minute, second, month, day, year
+const uint8_t setTimeFields[] PROGMEM = { DATETIME_SECOND, DATETIME_HOUR, DATETIME_MINUTE, DATETIME_SECOND,
+                                          DATETIME_MONTH, DATETIME_DAY, DATETIME_YEAR };
+
+volatile uint8_t rtcTicks = 0;  // Incremented once a second by the MFP interrupt
+volatile bool rtcAlarmPending = false; // Set by the MFP interrupt when it signals alarms instead
+uint8_t rtcTicksSeen      = 0;  // Ticks already applied to now
+uint16_t secondsSinceSync = 0;  // Seconds counted locally since the RTC was last read
+bool rtcSyncDue           = true;
+unsigned long lastTick    = 0;
+bool rtcReady             = false; // RTC found and running, until then the time is kept with millis()
+uint8_t rtcBootTries      = 0;
+uint8_t oscillatorPolls   = 0;  // OSCRUN checks since bootRTC() started the oscillator
+bool settingsLoaded       = false;
+unsigned long firstFrameTime = 0;  // us from reset to the first frame
+bool nightMode            = false; // Inside the NIGHT_START to NIGHT_END hours
+bool nightDark            = false; // Faded down for the night, loop() sleeps between interrupts
+bool nightDeep            = false; // Blank with the ADC off, powered down between ticks woken through PCINT2
+volatile uint8_t portDLevels = 0;  // PIND at the last PCINT2, to tell which pin changed
+volatile unsigned long tickMillis = 0; // What millis() should read at the last square wave tick while powered down
+extern volatile unsigned long timer0_millis; // The core's millis() count in wiring.c
+int8_t nightWakeTask      = TASK_NONE; // Lit by a button or clap, dims again when this runs
 
 MCP7940_Class MCP7940;
 DateTime now;
-DateTime then;
+uint8_t shownSecond = 0;        // Second of now last shown, to spot the next one
+BCDTime nowDigits;              // now as BCD digits for the tubes, refreshed whenever now changes
 int currTemp = 23;
 int currHumid = 30;
 int currUnit = CELS_SYMB;
-TimeSpan timeChange(0);
 
 TTSi7006 si7006 = TTSi7006(true);
 
-int brightness = MAX_BRIGHTNESS;
 int displayIndex = 0;
-int fadeFlag = 0;
 int isCycling = 0;
-unsigned long lastCycle = 0;
 
-int transitionFlag = 0;
-int transitionValue = 0;
-int transitionSlowdown = 0;
+#define FADE_TIME         256   //ms to fade out or back in when changing displays
+#define CROSSFADE_TIME    150   //ms for a tube to fade from one digit to the next
+#define TRANSITION_TIME   3000  //ms to blend from green back to orange after setting the time
+#define PULSE_TIME        1071  //ms from bright to dim for the set mode highlight, about 28 pulses a minute
+#define PULSE_MIN         28    //Dimmest level of the set mode highlight
+
+Tween fade;                   // Global brightness
+Tween transition;             // Blend from green to orange after setting the time
+Tween pulse;                  // Highlight level while setting the time
+uint8_t pulsing = 0;          // Bit per tube following the highlight pulse
 
 int changeColour = 0;
 int currentHue = 11;
 int currentSat = 255;
 
-CRGB defaultOrange = CHSV(13,255,255);
+DailyAlarm alarm;
+uint8_t alarmSetIndex = 0;      // Field being set in the alarm editor: 1 hour, 2 minute, 3 on/off, 0 not editing
+bool alarmRinging = false;
+int8_t alarmTask = TASK_NONE;   // Ring timeout or snooze, whichever is waiting
 
-#define CYCLE_PERIOD    5000 //ms
+Palette palette;
+uint16_t conversionRate = 0;    // HSV conversions per s over the last STATS_PERIOD
 
-CRGB colours[6];
+#define CYCLE_PERIOD    5000 //ms
 
+// Task periods, ms
+#define INPUT_PERIOD      2     // Buttons and peak detector
+#define CLOCK_PERIOD      10    // Apply RTC ticks to the displayed time
+#define SENSOR_PERIOD     5     // Step the background Si7006 measurement
+#define ANIMATION_PERIOD  10    // Sample the running tweens
+#define RENDER_PERIOD     10    // Push changed tubes
+#define STATS_PERIOD      10000 // Frame count into the trace and the HSV conversion rate for the next dump
+#define TASK_CAPACITY     10
+
+Scheduler<TASK_CAPACITY> scheduler;
+
+// Button indices for the event engine, SET is on port C and the rest on port B
+#define BTN_SET           0
+#define BTN_MODE          1
+#define BTN_UP            2
+#define BTN_DOWN          3
+#define NUM_BUTTONS       4
+
+Buttons<NUM_BUTTONS> buttons;
+ClapDetector clap;
+bool clapWasListening = false;  // clapListening() on the previous scan, claps start afresh when it comes back on
+volatile unsigned long peakTime = 0; // millis() at the last peak detector edge seen while powered down
+volatile bool peakClapped = false; // Two peak detector edges a clap apart while powered down
+
+// Trace events, logged with the value described
+#define TRACE_RTC_UP      0     // RTC found, attempts it took
+#define TRACE_RTC_READ    1     // us to read the time from the RTC
+#define TRACE_SENSOR      2     // us to read a new Si7006 measurement
+#define TRACE_BUTTON      3     // Button index << 8 | event type
+#define TRACE_CLAP        4     // Claps in the pattern
+#define TRACE_PUSH        5     // us to push the tubes that changed
+#define TRACE_OVERRUN     6     // us a scheduler pass took when it was longer than OVERRUN_TIME
+#define TRACE_FRAMES      7     // Low 16 bits of framesRendered, every STATS_PERIOD
+#define TRACE_ALARM       8     // Alarm went off (1), snoozed (2) or stopped (0)
+#define TRACE_NO_TASK     9     // No free task slot to retry the RTC, attempts so far
+#define TRACE_RTC_LOST    10    // RTC stopped answering, the time is kept locally until it is found again
+#define TRACE_RECORDS     32    // Records kept, must be a power of 2
+
+Trace<TRACE_RECORDS> trace;
+
+#define SETTINGS_RAM_ADDR 0    // Offset of the saved settings in the RTC battery-backed SRAM
+#define SETTINGS_MAGIC    0x4E // Marks the SRAM block as written by this sketch
+
+#define LAST_TIME_RAM_ADDR 8   // Offset of the last shown time in the RTC SRAM
+#define TRACE_RAM_ADDR    16   // Offset of the newest trace records saved by dumpTrace()
+#define TRACE_RAM_RECORDS 7    // Records that fit before the library's drift calibration at MCP7940_CAL_RAM_ADDR
+
+typedef TraceBlock<TRACE_RAM_RECORDS> SavedTrace;
+static_assert(TRACE_RAM_ADDR + sizeof(SavedTrace) <= MCP7940_CAL_RAM_ADDR, "Saved trace overlaps the calibration");
+
+// Settings kept in the RTC SRAM so they survive a power cycle
+struct Settings {
+  uint8_t magic;
+  uint8_t hue;
+  uint8_t sat;
+};
+
+// Time last shown, put back on the tubes at reset before the RTC is up
+struct LastTime {
+  uint8_t magic;
+  BCDTime time;
+};
+
+// SRAM budget for each part of the sketch in bytes, RAM_TUBES is set with the tube wiring. The build stops if a part
+// goes over, so the stack, the Serial and Wire buffers and whatever comes next keep their share of the 2KB
+#define RAM_SCHEDULER     192
+#define RAM_BUTTONS       160
+#define RAM_CLAP          64
+#define RAM_ANIMATION     48
+#define RAM_PALETTE       56
+#define RAM_CLOCK         48
+#define RAM_SENSOR        32
+#define RAM_TRACE         168
+#define RAM_ALARM         16
+
+// What each part uses, SRAM and the tables it keeps in flash. Printed by printMemoryStats()
+const uint16_t ramTubes       = sizeof(tubes) + sizeof(tubeTheme);
+const uint16_t ramScheduler   = sizeof(scheduler);
+const uint16_t ramButtons     = sizeof(buttons);
+const uint16_t ramClap        = sizeof(clap) + sizeof(clapWasListening) + sizeof(peakTime) + sizeof(peakClapped);
+const uint16_t ramAnimation   = sizeof(fade) + sizeof(transition) + sizeof(pulse) + sizeof(pulsing);
+const uint16_t ramPalette     = sizeof(palette) + sizeof(conversionRate);
+const uint16_t ramClock       = sizeof(MCP7940) + sizeof(now) + sizeof(nowDigits) + sizeof(shownSecond) +
+                                sizeof(rtcTicks) + sizeof(rtcTicksSeen) + sizeof(secondsSinceSync) +
+                                sizeof(rtcSyncDue) + sizeof(lastTick) + sizeof(rtcReady) + sizeof(rtcBootTries) + sizeof(oscillatorPolls) +
+                                sizeof(nightMode) + sizeof(nightDark) + sizeof(nightWakeTask) + sizeof(nightDeep) +
+                                sizeof(portDLevels) + sizeof(tickMillis);
+const uint16_t ramSensor      = sizeof(si7006);
+const uint16_t ramTrace       = sizeof(trace);
+const uint16_t ramAlarm       = sizeof(alarm) + sizeof(alarmSetIndex) + sizeof(alarmRinging) + sizeof(alarmTask) +
+                                sizeof(rtcAlarmPending);
+const uint16_t flashAnimation = sizeof(easeTable);
+const uint16_t flashPalette   = ClockGradient::TABLE_BYTES;
+const uint16_t flashClock     = sizeof(setTimeFields);
+
+// These parts are built from 8 and 16 bit fields, which are no smaller and pack no tighter on the host, so the host
+// build checks them too: a fit there is a fit on the AVR
+static_assert(ramTubes <= RAM_TUBES, "Tube display list is over its SRAM budget");
+static_assert(ramClap <= RAM_CLAP, "Clap detector is over its SRAM budget");
+static_assert(ramPalette <= RAM_PALETTE, "Palette is over its SRAM budget");
+static_assert(ramTrace <= RAM_TRACE, "Trace is over its SRAM budget");
+#ifdef __AVR__                  // The rest hold ints and pointers, their sizes only mean something on the AVR
+static_assert(ramScheduler <= RAM_SCHEDULER, "Scheduler is over its SRAM budget");
+static_assert(ramButtons <= RAM_BUTTONS, "Buttons are over their SRAM budget");
+static_assert(ramAnimation <= RAM_ANIMATION, "Tweens are over their SRAM budget");
+static_assert(ramClock <= RAM_CLOCK, "Clock is over its SRAM budget");
+static_assert(ramSensor <= RAM_SENSOR, "Sensor is over its SRAM budget");
+static_assert(ramAlarm <= RAM_ALARM, "Alarm is over its SRAM budget");
+#endif
+
+// The IDE generates these, they are written out so the sketch also compiles as plain C++ off the board
+void scanInputs();
+void updateClock();
+void updateSensor();
+void animate();
+void fadedOut();
+void nextCycle();
+void highlightTubes(uint8_t first);
+void setShortPress();
+void setLongPress();
+void rtcTickISR();
+void rtcAlarmISR();
+bool updateTime();
+bool loadSettings();
+void saveSettings();
+void loadLastTime();
+void saveLastTime();
+void bootRTC();
+void pollOscillator();
+void startRTC();
+void retryRTC(unsigned long period);
+void rtcLost();
+void modePress();
+void modeLongPress();
+void alarmSetPress();
+void ringAlarm();
+void endAlarm(uint8_t reason);
+void stopAlarm();
+void snoozeAlarm();
+void buttonEvent(const ButtonEvent &event);
+void stepValue(int8_t delta);
+bool clapListening();
+void clapped(uint8_t claps);
+void printTime();
+void printRenderStats();
+void printTaskStats();
+void printMemory(const __FlashStringHelper* name, uint16_t ram, uint16_t budget, uint16_t flash);
+void printMemoryStats();
+int freeMemory();
+void sampleStats();
+void printStats();
+void dumpTrace();
+void updateNight();
+bool nightHours(uint8_t hour);
+void dimForNight();
+void wakeDisplay();
+void keepAwake();
+void nightWakeEnd();
+void updateNightSleep();
+void startNightSleep();
+void stopNightSleep();
+void sleepUntilInterrupt();
+bool readRTC();
+void cycleDisplay();
+void updateColours();
+void renderTubes();
+void updateLEDs();
 
 
 void setup() {
   // put your setup code here, to run once:
   //Serial.begin(BAUD_RATE); //Using this will make right board (Seconds) stop working
-  pinMode(SW_UP_PIN, INPUT);
-  pinMode(SW_DOWN_PIN, INPUT);
-  pinMode(SW_SET_PIN, INPUT);
-  pinMode(SW_MODE_PIN, INPUT);
+  buttons.attach(BTN_SET, SW_SET_PIN);
+  buttons.attach(BTN_MODE, SW_MODE_PIN);
+  buttons.attach(BTN_UP, SW_UP_PIN, BUTTON_REPEAT);
+  buttons.attach(BTN_DOWN, SW_DOWN_PIN, BUTTON_REPEAT);
   pinMode(ATHRESH_PIN, INPUT);
   pinMode(AUD_ADC_PIN, INPUT);
+#if CLAP_ADC
+  clap.begin(AUD_ADC_PIN);
+#endif
 
   Serial.println(F("\nStarting NixieClock program version 0.1"));
   Serial.print(F("- Compiled with c++ version "));                            //                                  //
@@ -146,245 +378,358 @@ void setup() {
   Serial.print(F(__TIME__));                                                  //                                  //
   Serial.print(F("\n"));     
 
-  while (!MCP7940.begin()) {                                                  // Initialize RTC communications    //
-    Serial.println(F("Unable to find MCP7940M. Checking again in 3s."));      // Show error text                  //
-    delay(3000);                                                              // wait a second                    //
-  } // of loop until device is located 
+  Wire.begin();                                                               // bootRTC() starts the RTC later   //
+  now = DateTime(2000, 1, 1);                                                 // Shown if nothing was saved       //
+  nowDigits = BCDTime(now);
+  palette.set(THEME_TIME, CHSV(13,255,255));                                  // Orange until a colour is loaded  //
+  palette.set(THEME_HUMID, CHSV(140,220,225));                                // Nice blue                        //
+  palette.set(THEME_DATE, CHSV(89,255,255));                                  // Greenish                         //
+  palette.set(THEME_SET, CHSV(76,255,255));                                   // Fields already set               //
+  palette.set(THEME_HIGHLIGHT, CHSV(195,255,255));                            // Pulsed by the tweens             //
+  settingsLoaded = loadSettings();                                            // Restore the saved colour         //
+  loadLastTime();                                                             // and the last time shown          //
+  shownSecond = now.second();
+  lastTick = millis();
+
+  tubes.begin();
+  tubes.setCrossfade(CROSSFADE_TIME);
+
+  for(int i=0; i < NUM_TUBES; i++)
+    tubeTheme[i] = THEME_TIME;
+
+  FastLED.setDither(0); //Tubes are only pushed on change, so temporal dithering would freeze anyway
+  fade.set(MAX_BRIGHTNESS);
+  FastLED.setBrightness(fade.value());
+  tubes.snap();                                                               // Lit at once, no fade from blank  //
+  updateLEDs();                                                               // First frame before the RTC       //
+  firstFrameTime = micros();
+  Serial.print(F("First frame after us: "));
+  Serial.println(firstFrameTime);
+  printMemoryStats();
+
+  Serial.print(F("Si7006 is connected: "));                                   // Measured in the background       //
+  Serial.println(si7006.isConnected() ? F("Yes") : F("No"));
+
+  scheduler.every(INPUT_PERIOD, scanInputs, F("input"));
+  scheduler.every(CLOCK_PERIOD, updateClock, F("clock"));
+  scheduler.every(SENSOR_PERIOD, updateSensor, F("sensor"));
+  scheduler.every(ANIMATION_PERIOD, animate, F("animation"));
+  scheduler.every(RENDER_PERIOD, updateLEDs, F("render"));
+  scheduler.every(STATS_PERIOD, sampleStats, F("stats"), STATS_PERIOD);
+  scheduler.after(0, bootRTC, F("boot"));
+}
+
+//Brings up the RTC in the background, retrying a few times before running without it and checking again now and then
+void bootRTC() {
+  if(!MCP7940.begin()) {                                                      // Initialize RTC communications    //
+    if(++rtcBootTries < BOOT_RTC_TRIES) {
+      retryRTC(BOOT_RETRY_PERIOD);
+      return;
+    }
+    if(rtcBootTries == BOOT_RTC_TRIES)
+      Serial.println(F("Unable to find MCP7940M. Keeping time without it."));   // Show error text                  //
+    rtcBootTries = BOOT_RTC_TRIES + 1;
+    retryRTC(RTC_RETRY_PERIOD);
+    return;
+  } // of if-then device not found
   Serial.println(F("MCP7940 initialized."));                                  //                                  //
-  while (!MCP7940.deviceStatus()) {                                           // Turn oscillator on if necessary  //
+  trace.log(TRACE_RTC_UP, rtcBootTries + 1);
+  MCP7940.setRegisterShadow(true);                                            // Nothing else writes to the RTC   //
+  if (!MCP7940.deviceStatus() || !MCP7940.getOscillatorState()) {             // Turn oscillator on if necessary  //
     Serial.println(F("Oscillator is off, turning it on."));                   //                                  //
-    bool deviceStatus = MCP7940.deviceStart();                                // Start oscillator and return state//
-    if (!deviceStatus) {                                                      // If it didn't start               //
-      Serial.println(F("Oscillator did not start, trying again."));           // Show error and                   //
-      delay(1000);                                                            // wait for a second                //
-    } // of if-then oscillator didn't start                                   //                                  //
-  } // of while the oscillator is off                                         //                                  //
+    MCP7940.deviceStart(false);                                               // Set ST, don't wait for OSCRUN    //
+    oscillatorPolls = 0;
+    scheduler.after(OSC_POLL_PERIOD, pollOscillator, F("boot"));              // Checked from the boot task       //
+    return;
+  } // of if-then the oscillator is off                                       //                                  //
+  startRTC();
+}
+
+//Checks OSCRUN after bootRTC() set ST, the crystal takes a while to start and the tubes keep running meanwhile
+void pollOscillator() {
+  if(MCP7940.getOscillatorState()) {
+    startRTC();
+    return;
+  }
+  if(++oscillatorPolls < OSC_POLL_TRIES) {
+    if(scheduler.after(OSC_POLL_PERIOD, pollOscillator, F("boot")) == TASK_NONE)
+      trace.log(TRACE_NO_TASK, rtcBootTries);
+    return;
+  }
+  Serial.println(F("Oscillator did not start, trying again."));               // Show error and                   //
+  retryRTC(++rtcBootTries < BOOT_RTC_TRIES ? BOOT_RETRY_PERIOD : RTC_RETRY_PERIOD);
+}
+
+//Takes the time from the RTC once its oscillator is running, and from then on counts its square wave or alarms
+void startRTC() {
   //MCP7940.adjust();                                                           // Set to library compile Date/Time //
   Serial.println(F("Enabling battery backup mode"));                          //                                  //
   MCP7940.setBattery(true);                                                   // enable battery backup mode       //
-  then = MCP7940.now();
-  now = then;
-
-  Serial.print("Si7006 is connected: ");
-  Serial.println(si7006.isConnected() ? "Yes" : "No");
-
-  FastLED.addLeds<LED_TYPE, DIN_L1_PIN, COLOR_ORDER>(leds[DIN_L1], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN_L2_PIN, COLOR_ORDER>(leds[DIN_L2], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN1_PIN, COLOR_ORDER>(leds[DIN1], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN2_PIN, COLOR_ORDER>(leds[DIN2], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN_R1_PIN, COLOR_ORDER>(leds[DIN_R1], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN_R2_PIN, COLOR_ORDER>(leds[DIN_R2], NUM_LEDS);
-
-  for(int i=0; i < 6; i++)
-    colours[i] = defaultOrange;
+  if(!settingsLoaded)
+    settingsLoaded = loadSettings();                                          // Restore the saved colour         //
+  alarm.load(MCP7940);                                                        // and the alarm                    //
+  if(!readRTC())
+    return;                                                                   // Gone again, rtcLost() retries    //
+  shownSecond = now.second();
+  nowDigits = BCDTime(now);
+  secondsSinceSync = 0;
+  rtcSyncDue = false;
+  lastTick = millis();
+#if RTC_SQW_TIMEBASE
+  pinMode(RTC_MFP_PIN, INPUT_PULLUP);                                         // MFP is open drain                //
+  MCP7940.setSQWSpeed(0);                                                     // 1Hz square wave on MFP           //
+  rtcTicksSeen = rtcTicks;
+  attachInterrupt(digitalPinToInterrupt(RTC_MFP_PIN), rtcTickISR, FALLING);   // one edge per second              //
+#else
+  pinMode(RTC_MFP_PIN, INPUT_PULLUP);                                         // MFP is open drain                //
+  MCP7940.setAlarmPolarity(true);                                             // High while an alarm flag is set  //
+  MCP7940.clearAlarm(0);                                                      // Drop flags left from before      //
+  MCP7940.clearAlarm(1);                                                      // reset so the next one is an edge //
+  attachInterrupt(digitalPinToInterrupt(RTC_MFP_PIN), rtcAlarmISR, RISING);
+#endif
+  rtcReady = true;
+}
 
-  FastLED.setBrightness(brightness);
+//The RTC stopped answering. The time already shown carries on being counted with millis() and bootRTC() looks for
+//the RTC again in the background
+void rtcLost() {
+  rtcReady = false;
+  detachInterrupt(digitalPinToInterrupt(RTC_MFP_PIN));
+#if !RTC_SQW_TIMEBASE
+  lastTick = millis();                                                        // Square wave keeps the last edge  //
+#endif
+  rtcBootTries = 0;
+  trace.log(TRACE_RTC_LOST, 0);
+  retryRTC(BOOT_RETRY_PERIOD);
+}
 
+//Runs bootRTC() again after period. Called from the boot task, whose slot is free while it runs, so there is always
+//room unless something else took the slot first
+void retryRTC(unsigned long period) {
+  if(scheduler.after(period, bootRTC, F("boot")) == TASK_NONE)
+    trace.log(TRACE_NO_TASK, rtcBootTries);
 }
 
 void loop() {
-  //Read buttons/peak detector
-  currentStateSET = digitalRead(SW_SET_PIN);
-  currentStateMODE = digitalRead(SW_MODE_PIN);
-  currentStateATHRESH = digitalRead(ATHRESH_PIN);
-  
-
-  //SET Button - Long or short press
-  if(lastStateSET == LOW && currentStateSET == HIGH)        // button is pressed
-    pressedTimeSET = millis();
-  else if(lastStateSET == HIGH && currentStateSET == LOW) { // button is released
-    releasedTimeSET = millis();
-
-    long pressDuration = releasedTimeSET - pressedTimeSET;
-
-    if( pressDuration < SHORT_PRESS_TIME ) 
-      setShortPress();//Serial.println("SET - SHORT PRESS");
-    else
-      setLongPress();//Serial.println("SET - LONG PRESS");
-  }
+  uint16_t pass = scheduler.run();
+  if(pass > OVERRUN_TIME)
+    trace.log(TRACE_OVERRUN, pass);
+  updateNightSleep();
+  if(nightDark)
+    sleepUntilInterrupt();
+}
 
-  static bool isBright = 0;
-  if(lastStateMODE == LOW && currentStateMODE == HIGH)    // button is pressed
-  {
-    Serial.println("MODE - BUTTON PRESS");
-    if(changeColour == 1) {
-      changeColour = 2;
-      displayIndex = 1;
-      currTemp = currentSat;
-    } else if (changeColour == 0) {
-      changeColour = 1;
-      displayIndex = 1;
-      currTemp = currentHue;
-    } else {
-      changeColour = 0;
-      displayIndex = 0;
-    }
-  }
+//Acts on the queued button events and looks for claps
+void scanInputs() {
+  ButtonEvent event;
+  buttons.update();
+  while(buttons.read(event))
+    buttonEvent(event);
 
-  //Colour change mode enabled, so listen to up/down buttons and change accordingly
-  if(changeColour != 0) {
-    if(digitalRead(SW_UP_PIN) && (millis() - lastUPDOWN) > UPDOWN_COOLDOWN/2) {
-      if(changeColour == 1) {
-        currentHue++;
-          if(currentHue > 255)
-            currentHue = 0;
-          currTemp = currentHue;
-      } else {
-        currentSat++;
-        if(currentSat > 255)
-          currentSat = 0;
-        currTemp = currentSat;
-      }
-      for(int i=0;i<6;i++)
-        colours[i] = CHSV(currentHue,currentSat,255);
-      lastUPDOWN = millis();
-    } else if(digitalRead(SW_DOWN_PIN) && (millis() - lastUPDOWN) > UPDOWN_COOLDOWN/2) {
-      if(changeColour == 1) {
-        currentHue--;
-        if(currentHue < 0)
-          currentHue = 255;
-        currTemp = currentHue;
-      } else {
-        currentSat--;
-        if(currentSat < 0)
-          currentSat = 255;
-        currTemp = currentSat;
-      }
-      for(int i=0;i<6;i++)
-        colours[i] = CHSV(currentHue,currentSat,255);
-      lastUPDOWN = millis();
-    }
+  if(peakClapped) { //Heard on the peak detector while powered down for the night
+    peakClapped = false;
+    clapped(2);
   }
-
+  if(nightDeep)
+    return;
+
+#if CLAP_ADC
+  bool listening = clapListening();
+  if(listening && !clapWasListening)
+    clap.reset(); //Claps heard while editing or animating don't count towards the next pattern
+  clapWasListening = listening;
+  uint8_t claps = clap.update();
+  if(claps && listening)
+    clapped(claps);
+#else
+  currentStateATHRESH = digitalRead(ATHRESH_PIN);
 
   //Audio Spike - Did a double clap happen?
-  if(lastStateATHRESH == LOW && currentStateATHRESH == HIGH && !changeColour && !isCycling && setTimeIndex == 0 && !transitionFlag && fadeFlag == 0) {        // Sound happens
+  if(lastStateATHRESH == LOW && currentStateATHRESH == HIGH && clapListening()) {        // Sound happens
     currentClap = millis();
-    Serial.println("Audio Spike");
-    if(currentClap - lastClap > CLAP_MIN_TIME && currentClap - lastClap < CLAP_MAX_TIME) {
-      Serial.println("THE CLAPPER HAS HAPPENED"); //This is where you would call a function to display temperature
-      cycleDisplay();
-      //Print out humidity
-      Serial.print("Humidity: ");
-      Serial.print(si7006.readHumidity());
-      Serial.println(" % rel.");
-    
-      //Print out Temperature °C
-      Serial.print("Temperature: ");
-      Serial.print(si7006.readTemperatureC());
-      Serial.print(" ");
-      Serial.print(char(176));
-      Serial.println("C");
-    }
+    Serial.println(F("Audio Spike"));
+    if(currentClap - lastClap > CLAP_MIN_TIME && currentClap - lastClap < CLAP_MAX_TIME)
+      clapped(2);
 
     lastClap = currentClap;
   }
 
-  //Setting time mode enabled, so listen to up/down buttons and change accordingly
-  if(setTimeIndex != 0) {
-    if(digitalRead(SW_UP_PIN) && (millis() - lastUPDOWN) > UPDOWN_COOLDOWN) {
-      if( setTimeIndex == 4 )
-        now.incMonth();
-      else if( setTimeIndex == 6 )
-        now.incYear();
-      else
-        now = now + timeChange;
-      printTime(); 
-      lastUPDOWN = millis();
-    } else if(digitalRead(SW_DOWN_PIN) && (millis() - lastUPDOWN) > UPDOWN_COOLDOWN) {
-      if( setTimeIndex == 4 )
-        now.decMonth();
-      else if( setTimeIndex == 6 )
-        now.decYear();
-      else
-        now = now - timeChange;
-      printTime(); 
-      lastUPDOWN = millis();
-    }
-    if(setTimeIndex == 1 || setTimeIndex == 4) {
-      colours[DIN_L1] = CHSV(195,255,beatsin8(28,28,255));
-      colours[DIN_L2] = CHSV(195,255,beatsin8(28,28,255));
-      
-    } else if(setTimeIndex == 2 || setTimeIndex == 5) {
-      colours[DIN1] = CHSV(195,255,beatsin8(28,28,255));
-      colours[DIN2] = CHSV(195,255,beatsin8(28,28,255));
-    } else {
-      colours[DIN_R1] = CHSV(195,255,beatsin8(28,28,255));
-      colours[DIN_R2] = CHSV(195,255,beatsin8(28,28,255));
-    }
+  // save the the last state
+  lastStateATHRESH = currentStateATHRESH;
+#endif
+}
 
-    
-  } else {
+//Claps are ignored while editing, cycling or animating, apart from snoozing the alarm and lighting the tubes at night
+bool clapListening() {
+  if(alarmRinging)
+    return ALARM_CLAP_SNOOZE;
+  if(nightDark)
+    return true;
+  return !changeColour && !isCycling && setTimeIndex == 0 && alarmSetIndex == 0 && !transition.active() &&
+         !fade.active();
+}
 
-    now = MCP7940.now();
-    if(now.second() != then.second()) {
-      then = now;
-      printTime();                                            // Display the current date/time    //
-    }
+//A double or triple clap snoozes the alarm or starts the temp/humid/date cycle
+void clapped(uint8_t claps) {
+  trace.log(TRACE_CLAP, claps);
+  if(alarmRinging)
+    snoozeAlarm();
+  else if(nightDark)
+    keepAwake();
+  else
+    cycleDisplay();
+}
+
+//SET short/long press steps through or enters/leaves set mode, MODE steps the colour editor or, held, the alarm
+//editor and UP/DOWN change the value being edited, repeating while held. Any button stops the alarm
+void buttonEvent(const ButtonEvent &event) {
+  trace.log(TRACE_BUTTON, event.button << 8 | event.type);
+  if(alarmRinging) { //Stops on release so the rest of the press isn't taken as a command
+    if(event.type == BUTTON_RELEASE)
+      stopAlarm();
+    return;
+  }
+  if(nightDark) { //Same for lighting the tubes at night
+    if(event.type == BUTTON_RELEASE)
+      keepAwake();
+    return;
+  }
+  if(nightMode && event.type == BUTTON_PRESS)
+    keepAwake(); //Keeps the tubes lit while buttons are being used
+  switch(event.button) {
+    case BTN_SET:
+      if(event.type == BUTTON_SHORT)
+        setShortPress();
+      else if(event.type == BUTTON_LONG)
+        setLongPress();
+      break;
+    case BTN_MODE:
+      if(event.type == BUTTON_SHORT)
+        modePress();
+      else if(event.type == BUTTON_LONG)
+        modeLongPress();
+      break;
+    case BTN_UP:
+    case BTN_DOWN:
+      if(event.type == BUTTON_PRESS || event.type == BUTTON_HELD)
+        stepValue(event.button == BTN_UP ? 1 : -1);
+      else if(event.type == BUTTON_LONG && event.button == BTN_DOWN && buttons.isDown(BTN_UP) &&
+              !changeColour && setTimeIndex == 0 && alarmSetIndex == 0)
+        dumpTrace(); //Hold UP then DOWN while the time is showing
+      break;
   }
+}
 
-  //Fade handler
-  if(fadeFlag == 1) {
-    brightness -= 4;
-    if(brightness <= 0) {
-      brightness = 0;
-      fadeFlag++;
-      
-      displayIndex++;
-      if(displayIndex > 3) {
-        displayIndex = 0;
-        isCycling = 0;
-      } else {
-        isCycling = 1;
-        lastCycle = millis();
-      }
-      updateColours();
-        
-    }
-    FastLED.setBrightness(brightness);
-    
-  } else if(fadeFlag == 2) {
-    brightness += 4;
-    if(brightness >= MAX_BRIGHTNESS) {
-      brightness = MAX_BRIGHTNESS;
-      fadeFlag = 0;
+//UP/DOWN in the colour editor, set mode or the alarm editor
+void stepValue(int8_t delta) {
+  if(alarmSetIndex != 0) {
+    if(alarmSetIndex == 1)
+      alarm.adjust(DATETIME_HOUR, delta);
+    else if(alarmSetIndex == 2)
+      alarm.adjust(DATETIME_MINUTE, delta);
+    else
+      alarm.setOn(!alarm.on());
+  } else if(changeColour != 0) {
+    if(changeColour == 1) {
+      currentHue = (currentHue + delta) & 0xFF;
+      currTemp = currentHue;
+    } else {
+      currentSat = (currentSat + delta) & 0xFF;
+      currTemp = currentSat;
     }
-    FastLED.setBrightness(brightness);
+    palette.set(THEME_TIME, CHSV(currentHue,currentSat,255));
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_TIME;
+  } else if(setTimeIndex != 0) {
+    now.adjustField(pgm_read_byte(setTimeFields + setTimeIndex), delta);
+    nowDigits = BCDTime(now);
+    printTime();
   }
+}
 
-  if(isCycling) {
-    if( millis() - lastCycle >= CYCLE_PERIOD ) {
-      cycleDisplay();
-      isCycling = 0;
-    }
+//Applies RTC ticks to the displayed time, the time is left alone while it is being set. Also where the alarm is
+//checked, against the counted time while MFP carries the square wave and from the RTC flags once MFP signals it
+void updateClock() {
+  if(setTimeIndex == 0 && updateTime()) {
+    nowDigits = BCDTime(now);                                 // Digits only change once a second //
+    if(rtcReady && nowDigits.raw(DATETIME_SECOND) == 0)
+      saveLastTime();
+#if RTC_SQW_TIMEBASE
+    if(alarm.check(now))
+      ringAlarm();
+#endif
+    updateNight();
+  }
+#if !RTC_SQW_TIMEBASE
+  if(rtcAlarmPending) {
+    rtcAlarmPending = false;
+    if(alarm.service(MCP7940, now))
+      ringAlarm();
   }
+#endif
+}
 
-  if(transitionFlag && transitionSlowdown++ > 2) {
-    transitionSlowdown = 0;
-    transitionValue++;
-    CRGB tempCol = blend(CHSV(76,255,255), defaultOrange, transitionValue);
-    for(int i=0;i<6;i++)
-      colours[i] = tempCol;
+//Steps the background temperature/humidity measurement, readings are cached in si7006
+void updateSensor() {
+  unsigned long start = micros();
+  if(si7006.update())
+    trace.log(TRACE_SENSOR, micros() - start);
+}
 
-    if(transitionValue == 128)
-      displayIndex = 0;
-    if(transitionValue >= 255) {
-       transitionValue = 0;
-       transitionFlag = 0;
-    }
+//Samples the running tweens into the brightness and tube colours
+void animate() {
+  unsigned long t = millis();
+
+  fade.update(t);
+  FastLED.setBrightness(fade.value());
 
-    
+  if(pulse.update(t)) {
+    palette.set(THEME_PULSE, palette.dimmed(THEME_HIGHLIGHT, pulse.value()));
+    for(int i=0;i<NUM_TUBES;i++) {
+      if(pulsing & bit(i))
+        tubeTheme[i] = THEME_PULSE;
+    }
   }
-  
 
+  if(transition.update(t)) {
+    palette.set(THEME_BLEND, blend(palette[THEME_SET], palette[THEME_TIME], transition.value()));
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_BLEND;
+    if(transition.value() >= 128)
+      displayIndex = 0;
+  }
+}
 
-  // save the the last state
-  lastStateSET = currentStateSET;
-  lastStateMODE = currentStateMODE;
-  lastStateATHRESH = currentStateATHRESH;
+//Called once the tubes have faded out, switches to the next display and fades back in
+void fadedOut() {
+  displayIndex++;
+  if(displayIndex > 3) {
+    displayIndex = 0;
+    isCycling = 0;
+  } else {
+    isCycling = 1;
+    scheduler.after(CYCLE_PERIOD, nextCycle, F("cycle"));
+  }
+  updateColours();
+  tubes.snap(); //Dark anyway, the new display shouldn't fade in over the old one
+  fade.start(millis(), 0, MAX_BRIGHTNESS, FADE_TIME, EASE_IN_OUT);
+}
 
-  updateLEDs();
+//Moves on to the next display in the temp/humid/date cycle
+void nextCycle() {
+  cycleDisplay();
+  isCycling = 0;
+}
 
+//Pulses the pair of tubes starting at first, stops any other highlight. TUBE_BLANK stops them all
+void highlightTubes(uint8_t first) {
+  if(first >= NUM_TUBES) {
+    pulsing = 0;
+    pulse.stop();
+    return;
+  }
+  pulsing = bit(first) | bit(first + 1);
+  pulse.start(millis(), 255, PULSE_MIN, PULSE_TIME, EASE_SINE, TWEEN_PINGPONG);
 }
 
 //Function for when the SET button has a quick press, which is used for accepting the current value, and moving to the next sec/min/hour/day/month/yr
@@ -394,61 +739,53 @@ void setShortPress() {
     //Serial specific
     switch(setTimeIndex) {
       case 1: //Impossible
-        Serial.println("Set Hour");
-        timeChange = TimeSpan(0,1,0,0);
+        Serial.println(F("Set Hour"));
         break;
       case 2:
-        colours[DIN_L1] = defaultOrange;
-        colours[DIN_L2] = defaultOrange;
-        colours[DIN1] = CRGB::Indigo;
-        colours[DIN2] = CRGB::Indigo;
-        Serial.println("Set Minute");
-        timeChange = TimeSpan(0,0,1,0);
+        tubeTheme[DIN_L1] = THEME_TIME;
+        tubeTheme[DIN_L2] = THEME_TIME;
+        highlightTubes(DIN1);
+        Serial.println(F("Set Minute"));
         break;
       case 3:
-        colours[DIN1] = defaultOrange;
-        colours[DIN2] = defaultOrange;
-        colours[DIN_R1] = CRGB::Indigo;
-        colours[DIN_R2] = CRGB::Indigo;
-        Serial.println("Set Second");
-        timeChange = TimeSpan(0,0,0,1);
+        tubeTheme[DIN1] = THEME_TIME;
+        tubeTheme[DIN2] = THEME_TIME;
+        highlightTubes(DIN_R1);
+        Serial.println(F("Set Second"));
         break;
       case 4:
 //        colours[DIN_R1] = defaultOrange;
 //        colours[DIN_R2] = defaultOrange;CHSV(96,200,255)
-        colours[DIN_R1] = CHSV(76,255,255);
-        colours[DIN_R2] = CHSV(76,255,255);
-        colours[DIN1] = CHSV(76,255,255);
-        colours[DIN2] = CHSV(76,255,255);
-        colours[DIN_L1] = CRGB::Indigo;
-        colours[DIN_L2] = CRGB::Indigo;
-        Serial.println("Set Month");
+        tubeTheme[DIN_R1] = THEME_SET;
+        tubeTheme[DIN_R2] = THEME_SET;
+        tubeTheme[DIN1] = THEME_SET;
+        tubeTheme[DIN2] = THEME_SET;
+        highlightTubes(DIN_L1);
+        Serial.println(F("Set Month"));
         displayIndex = 3;
         break;
       case 5:
-        colours[DIN_L1] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN_L2] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN1] = CRGB::Indigo;
-        colours[DIN2] = CRGB::Indigo;
-        Serial.println("Set Day");
-        timeChange = TimeSpan(1,0,0,0);
+        tubeTheme[DIN_L1] = THEME_SET;
+        tubeTheme[DIN_L2] = THEME_SET;
+        highlightTubes(DIN1);
+        Serial.println(F("Set Day"));
         break;
       case 6:
-        colours[DIN1] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN2] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN_R1] = CRGB::Indigo;
-        colours[DIN_R2] = CRGB::Indigo;
-        Serial.println("Set Year");
+        tubeTheme[DIN1] = THEME_SET;
+        tubeTheme[DIN2] = THEME_SET;
+        highlightTubes(DIN_R1);
+        Serial.println(F("Set Year"));
         break;
       case 7:
-        colours[DIN_R1] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN_R2] = CHSV(76,255,255);//defaultOrange;
-        Serial.println("Finished Setting");
+        tubeTheme[DIN_R1] = THEME_SET;
+        tubeTheme[DIN_R2] = THEME_SET;
+        Serial.println(F("Finished Setting"));
         //displayIndex = 0;
-        transitionFlag = 1;
-        transitionValue = 0;
+        highlightTubes(TUBE_BLANK);
+        transition.start(millis(), 0, 255, TRANSITION_TIME);
         setTimeIndex = 0;
-        MCP7940.adjust(now);
+        MCP7940.adjust(now);   // now stood still in the editor, so it is no reference to measure drift against
+        rtcSyncDue = true;
         break;
     }
 
@@ -458,147 +795,579 @@ void setShortPress() {
 //Function for handling a long press of the SET button, which either enters the mode for setting the time/date or accepts all changes and resumes normal operation
 void setLongPress() {
   if(setTimeIndex == 0) {
-    colours[DIN_L1] = CRGB::Indigo;
-    colours[DIN_L2] = CRGB::Indigo;
+    highlightTubes(DIN_L1);
     setTimeIndex = 1;
-    Serial.println("Set Hour");
-    timeChange = TimeSpan(0,1,0,0);
+    Serial.println(F("Set Hour"));
   } else {
-    for(int i=0;i<6;i++)
-    colours[i] = defaultOrange;
+    highlightTubes(TUBE_BLANK);
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_TIME;
     displayIndex = 0;
     setTimeIndex = 0;
     MCP7940.adjust(now);
+    rtcSyncDue = true;
+  }
+}
+
+//Square wave interrupt from the RTC MFP pin, fires once a second. Timer0 stops while the CPU is powered down for
+//the night, so each tick then also moves millis() on to a second after the last one if it has fallen behind
+void rtcTickISR() {
+  rtcTicks++;
+  if(nightDeep) {
+    tickMillis += 1000;
+    if((long)(timer0_millis - tickMillis) < 0)
+      timer0_millis = tickMillis;
+  }
+}
+
+//Alarm interrupt from the RTC MFP pin, the flags are read outside the ISR
+void rtcAlarmISR() {
+  rtcAlarmPending = true;
+}
+
+//Pin change interrupts for the buttons, UP/DOWN/MODE on port B and SET on port C
+ISR(PCINT0_vect) {
+  buttons.sample();
+}
+
+ISR(PCINT1_vect) {
+  buttons.sample();
+}
+
+//Pin changes on port D while powered down for the night, pin numbers are the port bits. INT0 can't see the square
+//wave's edges without the I/O clock, and the peak detector stands in for the stopped ADC: two peaks CLAP_MIN_TIME to
+//CLAP_MAX_TIME apart are a double clap
+ISR(PCINT2_vect) {
+  uint8_t levels = PIND;
+  uint8_t changed = levels ^ portDLevels;
+  portDLevels = levels;
+  if((changed & bit(RTC_MFP_PIN)) && !(levels & bit(RTC_MFP_PIN)))
+    rtcTickISR();
+  if((changed & bit(ATHRESH_PIN)) && (levels & bit(ATHRESH_PIN))) {
+    unsigned long time = millis();
+    if(time - peakTime > CLAP_MIN_TIME && time - peakTime < CLAP_MAX_TIME)
+      peakClapped = true;
+    peakTime = time;
   }
 }
 
+#if CLAP_ADC
+//Free running audio conversions for the clap detector
+ISR(ADC_vect) {
+  clap.sample(ADCH);
+}
+#endif
+
+//Brings now up to date, returns true if the second has changed since the last call
+bool updateTime() {
+  if(!rtcReady) { //No RTC yet, count seconds from the time that was restored
+    if(millis() - lastTick < 1000)
+      return false;
+    lastTick += 1000;
+    now.tick();
+    shownSecond = now.second();
+    return true;
+  }
+#if RTC_SQW_TIMEBASE
+  uint8_t ticks = rtcTicks - rtcTicksSeen; //single byte read is atomic and only the ISR writes rtcTicks
+  if(ticks == 0) {
+    if(millis() - lastTick < RTC_TICK_TIMEOUT)
+      return false;
+    rtcSyncDue = true; //No square wave, MFP not wired or RTC reset. Poll until edges come back
+  } else {
+    rtcTicksSeen += ticks;
+    secondsSinceSync += ticks;
+    lastTick = millis();
+  }
+
+  if(rtcSyncDue || secondsSinceSync >= RTC_SYNC_PERIOD) {
+    if(!readRTC())
+      now.tick(ticks);                                        //Lost the RTC, carry on from the counted time
+    secondsSinceSync = 0;
+    rtcSyncDue = false;
+  } else {
+    now.tick(ticks);
+  }
+  if(now.second() == shownSecond)
+    return false;
+  shownSecond = now.second();
+  return true;
+#else
+  if(!MCP7940.now(now)) {
+    rtcLost();
+    return false;
+  }
+  if(now.second() == shownSecond)
+    return false;
+  shownSecond = now.second();
+  return true;
+#endif
+}
+
+//Restores the colour settings from the RTC SRAM, keeps the defaults if nothing was saved yet. Returns false if the
+//RTC didn't answer
+bool loadSettings() {
+  Settings saved;
+  if(MCP7940.readRAM(SETTINGS_RAM_ADDR, saved) != sizeof(saved))
+    return false;
+  if(saved.magic != SETTINGS_MAGIC)
+    return true;
+  currentHue = saved.hue;
+  currentSat = saved.sat;
+  palette.set(THEME_TIME, CHSV(currentHue,currentSat,255));
+  return true;
+}
+
+//Stores the colour settings in the RTC SRAM
+void saveSettings() {
+  Settings saved;
+  saved.magic = SETTINGS_MAGIC;
+  saved.hue = currentHue;
+  saved.sat = currentSat;
+  MCP7940.writeRAM(SETTINGS_RAM_ADDR, saved);
+}
+
+//Puts the last shown time back so the tubes have something to show straight after reset
+void loadLastTime() {
+  LastTime last;
+  if(MCP7940.readRAM(LAST_TIME_RAM_ADDR, last) != sizeof(last) || last.magic != SETTINGS_MAGIC)
+    return;
+  nowDigits = last.time;
+  now = last.time.toDateTime();
+}
+
+//Stores the shown time in the RTC SRAM, called once a minute
+void saveLastTime() {
+  LastTime last;
+  last.magic = SETTINGS_MAGIC;
+  last.time = nowDigits;
+  MCP7940.writeRAM(LAST_TIME_RAM_ADDR, last);
+}
+
+//MODE steps the colour editor from hue to saturation and then saves and leaves it, or steps the alarm editor
 void modePress() {
-  //cycleDisplay();
+  Serial.println(F("MODE - BUTTON PRESS"));
+  if(alarmSetIndex != 0) {
+    alarmSetPress();
+  } else if(changeColour == 1) {
+    changeColour = 2;
+    displayIndex = 1;
+    currTemp = currentSat;
+  } else if (changeColour == 0) {
+    changeColour = 1;
+    displayIndex = 1;
+    currTemp = currentHue;
+  } else {
+    changeColour = 0;
+    displayIndex = 0;
+    palette.set(THEME_TIME, CHSV(currentHue,currentSat,255));
+    saveSettings();
+  }
+}
+
+//Holding MODE while the time is showing opens the alarm editor on the hour
+void modeLongPress() {
+  if(alarmSetIndex != 0 || setTimeIndex != 0 || changeColour != 0)
+    return;
+  Serial.println(F("Set Alarm Hour"));
+  alarmSetIndex = 1;
+  displayIndex = 4;
+  for(int i=0;i<NUM_TUBES;i++)
+    tubeTheme[i] = THEME_TIME;
+  highlightTubes(DIN_L1);
+}
+
+//MODE in the alarm editor moves from the hour to the minute to on/off, then saves the alarm to the RTC and leaves
+void alarmSetPress() {
+  alarmSetIndex++;
+  switch(alarmSetIndex) {
+    case 2:
+      tubeTheme[DIN_L1] = THEME_SET;
+      tubeTheme[DIN_L2] = THEME_SET;
+      highlightTubes(DIN1);
+      Serial.println(F("Set Alarm Minute"));
+      break;
+    case 3:
+      tubeTheme[DIN1] = THEME_SET;
+      tubeTheme[DIN2] = THEME_SET;
+      highlightTubes(DIN_R1);
+      Serial.println(F("Set Alarm On/Off"));
+      break;
+    default:
+      Serial.println(alarm.on() ? F("Alarm On") : F("Alarm Off"));
+      highlightTubes(TUBE_BLANK);
+      alarmSetIndex = 0;
+      displayIndex = 0;
+      updateColours();
+      stopAlarm(); //Drops a snooze that is waiting
+      if(rtcReady)
+        alarm.save(MCP7940);
+      break;
+  }
+}
+
+//Pulses every tube in the highlight colour until a button stops it, a clap snoozes it or ALARM_RING_TIME passes.
+//Editing wins, an alarm that comes up while something is being set is dropped
+void ringAlarm() {
+  alarmTask = TASK_NONE;
+  if(setTimeIndex != 0 || alarmSetIndex != 0 || changeColour != 0)
+    return;
+  trace.log(TRACE_ALARM, 1);
+  wakeDisplay();
+  alarmRinging = true;
+  displayIndex = 0;
+  pulsing = bit(NUM_TUBES) - 1;
+  pulse.start(millis(), 255, PULSE_MIN, PULSE_TIME, EASE_SINE, TWEEN_PINGPONG);
+  alarmTask = scheduler.after(ALARM_RING_TIME, stopAlarm, F("alarm"));
+}
+
+//Silences the alarm, logging why, and cancels the ring timeout or a snooze that is waiting
+void endAlarm(uint8_t reason) {
+  if(alarmTask != TASK_NONE)
+    scheduler.cancel(alarmTask);
+  alarmTask = TASK_NONE;
+  if(!alarmRinging)
+    return;
+  trace.log(TRACE_ALARM, reason);
+  alarmRinging = false;
+  highlightTubes(TUBE_BLANK);
+  updateColours();
+}
+
+void stopAlarm() {
+  endAlarm(0);
+}
+
+//Silences the alarm and rings again after ALARM_SNOOZE_TIME
+void snoozeAlarm() {
+  endAlarm(2);
+  alarmTask = scheduler.after(ALARM_SNOOZE_TIME, ringAlarm, F("alarm"));
 }
 
 //Serial printout of current time
 void printTime() {
-  sprintf(inputBuffer,"%04d-%02d-%02d %02d:%02d:%02d", now.year(),          // Use sprintf() to pretty print    //
+  char buffer[20];                                                          // Only on the stack while printing //
+  sprintf_P(buffer, PSTR("%04d-%02d-%02d %02d:%02d:%02d"), now.year(),      // Use sprintf() to pretty print    //
             now.month(), now.day(), now.hour(), now.minute(), now.second());  // date/time with leading zeros     //
-  Serial.println(inputBuffer);                                              // Display the current date/time    //
+  Serial.println(buffer);                                                   // Display the current date/time    //
+}
+
+//Serial printout of how many frames actually had to be pushed to the tubes
+void printRenderStats() {
+  Serial.print(F("Frames rendered: "));
+  Serial.print(framesRendered);
+  Serial.print(F(" skipped: "));
+  Serial.println(framesSkipped);
+  Serial.print(F("First frame after us: "));
+  Serial.println(firstFrameTime);
+  Serial.print(F("HSV conversions per s: "));
+  Serial.println(conversionRate);
+}
+
+//Serial printout of the longest and typical time each task takes to run, and the longest any task had to wait
+void printTaskStats() {
+  for(int i=0;i<scheduler.capacity();i++) {
+    if(scheduler.name(i) == NULL)
+      continue;
+    Serial.print(scheduler.name(i));
+    Serial.print(F(" worst us: "));
+    Serial.print(scheduler.worstCase(i));
+    Serial.print(F(" typical us: "));
+    Serial.println(scheduler.typical(i));
+  }
+  Serial.print(F("Longest pass us: "));
+  Serial.println(scheduler.worstPass());
+}
+
+//Serial printout of one part's SRAM against its budget and the tables it keeps in flash
+void printMemory(const __FlashStringHelper* name, uint16_t ram, uint16_t budget, uint16_t flash) {
+  Serial.print(name);
+  Serial.print(F(" RAM: "));
+  Serial.print(ram);
+  Serial.print(F(" of "));
+  Serial.print(budget);
+  Serial.print(F(" flash tables: "));
+  Serial.println(flash);
+}
+
+//Serial printout of the memory each part of the sketch uses, and how much is left between the heap and the stack
+void printMemoryStats() {
+  printMemory(F("tubes"), ramTubes, RAM_TUBES, 0);
+  printMemory(F("scheduler"), ramScheduler, RAM_SCHEDULER, 0);
+  printMemory(F("buttons"), ramButtons, RAM_BUTTONS, 0);
+  printMemory(F("clap"), ramClap, RAM_CLAP, 0);
+  printMemory(F("animation"), ramAnimation, RAM_ANIMATION, flashAnimation);
+  printMemory(F("palette"), ramPalette, RAM_PALETTE, flashPalette);
+  printMemory(F("clock"), ramClock, RAM_CLOCK, flashClock);
+  printMemory(F("sensor"), ramSensor, RAM_SENSOR, 0);
+  printMemory(F("trace"), ramTrace, RAM_TRACE, 0);
+  printMemory(F("alarm"), ramAlarm, RAM_ALARM, 0);
+  Serial.print(F("Free RAM: "));
+  Serial.println(freeMemory());
+}
+
+#ifdef __AVR__
+extern char __heap_start;
+extern char* __brkval;
+#endif
+
+//Bytes between the top of the heap and the stack, 0 off the board
+int freeMemory() {
+#ifdef __AVR__
+  char top;
+  return &top - (__brkval ? __brkval : &__heap_start);
+#else
+  return 0;
+#endif
+}
+
+//Logs the frames pushed so far and works out the HSV conversion rate. Nothing is printed while the clock runs, the
+//figures go out with the trace from dumpTrace()
+void sampleStats() {
+  trace.log(TRACE_FRAMES, framesRendered);
+  conversionRate = palette.takeConversions() * 1000UL / STATS_PERIOD;
+}
+
+void printStats() {
+  printRenderStats();
+  printTaskStats();
+}
+
+//Saves the newest trace records in the RTC SRAM and sends the trace over serial, the block saved last time first.
+//Pins 0/1 carry the DIN_R1/DIN_R2 data, so the tubes are blanked while it is sent and pushed again afterwards
+void dumpTrace() {
+  SavedTrace saved;
+  bool hadSaved = rtcReady && MCP7940.readRAM(TRACE_RAM_ADDR, saved) == sizeof(saved) && saved.valid();
+
+  tubes.clear();
+  tubes.snap();
+  tubes.show(FastLED.getBrightness(), palette.colours());
+  Serial.begin(BAUD_RATE);
+  if(hadSaved)
+    Serial.write((const uint8_t*)&saved, saved.size());
+  trace.dump(Serial);
+  printStats();                 //Text after the blocks, decode_trace.py skips it
+  Serial.flush();
+  Serial.end();
+  tubes.refresh();
+
+  if(rtcReady) {
+    trace.save(saved);
+    MCP7940.writeRAM(TRACE_RAM_ADDR, saved);
+  }
+}
+
+//Called each second, dims the tubes once the night hours start and nothing is going on, and lights them again
+//when the night is over
+void updateNight() {
+  if(!nightHours(now.hour())) {
+    if(nightMode) {
+      nightMode = false;
+      wakeDisplay();
+    }
+    return;
+  }
+  nightMode = true;
+  if(!nightDark && nightWakeTask == TASK_NONE && !fade.active() && !isCycling && !transition.active() &&
+     !alarmRinging && setTimeIndex == 0 && alarmSetIndex == 0 && changeColour == 0)
+    dimForNight();
+}
+
+//True if the hour is between NIGHT_START and NIGHT_END, which can run past midnight
+bool nightHours(uint8_t hour) {
+  if(NIGHT_START <= NIGHT_END)
+    return hour >= NIGHT_START && hour < NIGHT_END;
+  return hour >= NIGHT_START || hour < NIGHT_END;
+}
+
+void dimForNight() {
+  nightDark = true;
+  fade.start(millis(), fade.value(), NIGHT_BRIGHTNESS, FADE_TIME, EASE_IN_OUT);
+}
+
+//Fades the tubes back in if they are dark or dimming for the night
+void wakeDisplay() {
+  if(!nightDark)
+    return;
+  nightDark = false;
+  fade.start(millis(), fade.value(), MAX_BRIGHTNESS, FADE_TIME, EASE_IN_OUT);
+}
+
+//Lights the tubes at night for NIGHT_WAKE_TIME from now, calling it again restarts the time
+void keepAwake() {
+  if(nightWakeTask != TASK_NONE)
+    scheduler.cancel(nightWakeTask);
+  nightWakeTask = scheduler.after(NIGHT_WAKE_TIME, nightWakeEnd, F("wake"));
+  wakeDisplay();
+}
+
+void nightWakeEnd() {
+  nightWakeTask = TASK_NONE;
+}
+
+//Powers down between ticks while the tubes are blank for the night and the square wave is being counted, and goes
+//back to idle sleep as soon as anything lights them or the RTC is lost
+void updateNightSleep() {
+  bool deep = NIGHT_POWER_DOWN && RTC_SQW_TIMEBASE && NIGHT_BRIGHTNESS == 0 && nightDark && rtcReady &&
+              !fade.active() && !alarmRinging;
+  if(deep && !nightDeep)
+    startNightSleep();
+  else if(!deep && nightDeep)
+    stopNightSleep();
+}
+
+//Stops the ADC and moves the square wave from INT0 to PCINT2 with the peak detector, the only port D pin changes
+//that can wake the CPU from power-down apart from the buttons on ports B and C
+void startNightSleep() {
+  nightDeep = true;
+#if CLAP_ADC
+  clap.stop();
+#endif
+  detachInterrupt(digitalPinToInterrupt(RTC_MFP_PIN));
+  uint8_t oldSREG = SREG;
+  cli();
+  tickMillis = lastTick + 1000UL * (uint8_t)(rtcTicks - rtcTicksSeen); //Ticks counted but not applied yet
+  peakTime = millis() - CLAP_MAX_TIME;
+  portDLevels = PIND;
+  PCMSK2 |= bit(RTC_MFP_PIN) | bit(ATHRESH_PIN);
+  PCICR |= bit(PCIE2);
+  SREG = oldSREG;
+}
+
+//Back to INT0 for the square wave, if the RTC is still there, and the ADC for claps
+void stopNightSleep() {
+  nightDeep = false;
+  uint8_t oldSREG = SREG;
+  cli();
+  PCMSK2 &= ~(bit(RTC_MFP_PIN) | bit(ATHRESH_PIN));
+  PCICR &= ~bit(PCIE2);
+  SREG = oldSREG;
+  if(rtcReady)
+    attachInterrupt(digitalPinToInterrupt(RTC_MFP_PIN), rtcTickISR, FALLING);
+#if CLAP_ADC
+  clap.reset();
+  clap.begin(AUD_ADC_PIN);
+#endif
+}
+
+//Sleeps until the next interrupt. Powered down for the night only the RTC tick, a button or the peak detector wakes
+//it, and it idles instead while a button is down or a clap is being timed, as those need millis(). Otherwise it
+//idles with Timer0, the ADC, the pin change interrupts and INT0 all running, so loop() just stops spinning between
+//tasks. Interrupts stay off from the check until sleep_cpu(), which runs before any held interrupt can
+void sleepUntilInterrupt() {
+  cli();
+  bool powerDown = nightDeep && !buttons.busy() && millis() - peakTime >= CLAP_MAX_TIME;
+  set_sleep_mode(powerDown ? SLEEP_MODE_PWR_DOWN : SLEEP_MODE_IDLE);
+  sleep_enable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+}
+
+//Reads the time from the RTC, logging how long it took. If it doesn't answer now is left alone, the RTC is marked
+//lost and false returned
+bool readRTC() {
+  unsigned long start = micros();
+  if(!MCP7940.now(now)) {
+    rtcLost();
+    return false;
+  }
+  trace.log(TRACE_RTC_READ, micros() - start);
+  return true;
 }
 
 //Kicks off the fade flag which begins cycling through temp/humid/date displays
 void cycleDisplay() {
-  if(setTimeIndex == 0) { //DO NOT want to start cycling while you're in the middle of setting the time
-    currTemp = round( si7006.readTemperatureC() ); //Calibrated with thermal chamber, looks accurate enough
-    currHumid = round( si7006.readHumidity() );
-    fadeFlag = 1;
+  if(setTimeIndex == 0 && !alarmRinging) { //DO NOT want to start cycling while you're in the middle of setting the time
+    currTemp = round( si7006.temperatureC() ); //Calibrated with thermal chamber, looks accurate enough
+    currHumid = round( si7006.humidity() );
+    fade.start(millis(), MAX_BRIGHTNESS, 0, FADE_TIME, EASE_IN_OUT, TWEEN_ONCE, fadedOut);
   }
 }
 
 //Updates the colours based on which set of data is being shown
 void updateColours() {
   if(displayIndex == 0) { //time
-    for(int i=0;i<6;i++)
-      colours[i] = defaultOrange;     
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_TIME;     
            
   } else if(displayIndex == 1) { //temp could adjust based on temp
-    CRGB tempCol = CRGB::White;
-    if(currTemp >= 30)
-      tempCol = CHSV(0,255,255);
-    else if(currTemp <= 15)
-      tempCol = CHSV(140,40,255);
-    else {
-      switch(currTemp) {
-        case 29:
-          tempCol = CHSV(2,255,255);
-          break;
-        case 28:
-          tempCol = CHSV(3,255,255);
-          break;
-        case 27:
-          tempCol = CHSV(5,255,255);
-          break;
-        case 26:
-          tempCol = CHSV(7,255,255);
-          break;
-        case 25:
-          tempCol = CHSV(9,255,255);
-          break;
-        case 24:
-          tempCol = CHSV(11,255,255);
-          break;
-        case 23:
-          tempCol = CHSV(15,255,255);
-          break;
-        case 22:
-          tempCol = CHSV(26,255,255);
-          break;
-        case 21:
-          tempCol = CHSV(26,225,255);
-          break;
-        case 20:
-          tempCol = CHSV(26,200,255);
-          break;
-        case 19:
-          tempCol = CHSV(27,210,255);
-          break;
-        case 18:
-          tempCol = CHSV(29,185,255);
-          break;
-        case 17:
-          tempCol = CHSV(30,160,255);
-          break;
-        case 16:
-          tempCol = CHSV(70,118,255);
-          break;
-      }
-    }
-    for(int i=0;i<6;i++)
-      colours[i] = tempCol;
+    palette.set(THEME_TEMP, ClockGradient::lookup(si7006.temperatureC())); //Quarter degree steps, from the cached reading
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_TEMP;
       
   } else if(displayIndex == 2) { //humid could adjust based on value
-   for(int i=0;i<6;i++)
-      colours[i] = CHSV(140,220,225); //nice blue
+   for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_HUMID;
       
   } else if(displayIndex == 3) { //date could adjust based on season
-    for(int i=0;i<6;i++)
-      colours[i] = CHSV(89,255,255); //Greenish
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_DATE;
 
+  } else if(displayIndex == 4) { //alarm
+    for(int i=0;i<NUM_TUBES;i++)
+      tubeTheme[i] = THEME_TIME;
+  }
+}
+
+//Pushes only the tubes whose digit, colour or brightness changed since they were last shown
+void renderTubes() {
+  unsigned long start = micros();
+  bool pushed = tubes.show(FastLED.getBrightness(), palette.colours(), palette.takeChanged());
+  if(pushed) {
+    framesRendered++;
+    trace.log(TRACE_PUSH, micros() - start);
+  } else {
+    framesSkipped++;
   }
 }
 
 //Updates the tube LEDs
 void updateLEDs() {
-  FastLED.clear();
+  tubes.clear();
+  if(nightDark && NIGHT_BRIGHTNESS == 0 && !fade.active()) { //Blank, nothing changes until morning
+    renderTubes();
+    return;
+  }
   switch(displayIndex) {
     case 0: //time
-      leds[DIN_L1][now.hour() / 10] = colours[DIN_L1];
-      leds[DIN_L2][now.hour() % 10] = colours[DIN_L2];
-      leds[DIN1][now.minute() / 10] = colours[DIN1];
-      leds[DIN2][now.minute() % 10] = colours[DIN2];
-      leds[DIN_R1][now.second() / 10] = colours[DIN_R1];
-      leds[DIN_R2][now.second() % 10] = colours[DIN_R2];
+      tubes.set(DIN_L1, nowDigits.tens(DATETIME_HOUR), tubeTheme[DIN_L1]);
+      tubes.set(DIN_L2, nowDigits.ones(DATETIME_HOUR), tubeTheme[DIN_L2]);
+      tubes.set(DIN1, nowDigits.tens(DATETIME_MINUTE), tubeTheme[DIN1]);
+      tubes.set(DIN2, nowDigits.ones(DATETIME_MINUTE), tubeTheme[DIN2]);
+      tubes.set(DIN_R1, nowDigits.tens(DATETIME_SECOND), tubeTheme[DIN_R1]);
+      tubes.set(DIN_R2, nowDigits.ones(DATETIME_SECOND), tubeTheme[DIN_R2]);
       break;
     case 1: //temp
       if(currTemp < 0)
-        leds[DIN_L1][MINUS_SYMB] = colours[DIN_L1];
+        tubes.set(DIN_L1, MINUS_SYMB, tubeTheme[DIN_L1]);
       if(abs(currTemp) >= 100)
-        leds[DIN_L2][abs(currTemp) / 100] = colours[DIN_L2];
-      leds[DIN1][(abs(currTemp)/10) % 10] = colours[DIN1];
-      leds[DIN2][abs(currTemp) % 10] = colours[DIN2];
-      leds[DIN_R1][currUnit] = colours[DIN_R1];
+        tubes.set(DIN_L2, abs(currTemp) / 100, tubeTheme[DIN_L2]);
+      tubes.set(DIN1, (abs(currTemp)/10) % 10, tubeTheme[DIN1]);
+      tubes.set(DIN2, abs(currTemp) % 10, tubeTheme[DIN2]);
+      tubes.set(DIN_R1, currUnit, tubeTheme[DIN_R1]);
       break;      
     case 2: //humid
-      leds[DIN_L1][RH_SYMB] = colours[DIN_L1];
-      leds[DIN1][currHumid / 10] = colours[DIN1];
-      leds[DIN2][currHumid % 10] = colours[DIN2];
-      leds[DIN_R1][PCNT_SYMB] = colours[DIN_L1];
+      tubes.set(DIN_L1, RH_SYMB, tubeTheme[DIN_L1]);
+      tubes.set(DIN1, currHumid / 10, tubeTheme[DIN1]);
+      tubes.set(DIN2, currHumid % 10, tubeTheme[DIN2]);
+      tubes.set(DIN_R1, PCNT_SYMB, tubeTheme[DIN_L1]);
       break;
     case 3: //date
-      leds[DIN_L1][now.month() / 10] = colours[DIN_L1];
-      leds[DIN_L2][now.month() % 10] = colours[DIN_L2];
-      leds[DIN1][now.day() / 10] = colours[DIN1];
-      leds[DIN2][now.day() % 10] = colours[DIN2];
-      leds[DIN_R1][(now.year()/10) % 10] = colours[DIN_R1];
-      leds[DIN_R2][now.year() % 10] = colours[DIN_R2];
+      tubes.set(DIN_L1, nowDigits.tens(DATETIME_MONTH), tubeTheme[DIN_L1]);
+      tubes.set(DIN_L2, nowDigits.ones(DATETIME_MONTH), tubeTheme[DIN_L2]);
+      tubes.set(DIN1, nowDigits.tens(DATETIME_DAY), tubeTheme[DIN1]);
+      tubes.set(DIN2, nowDigits.ones(DATETIME_DAY), tubeTheme[DIN2]);
+      tubes.set(DIN_R1, nowDigits.tens(DATETIME_YEAR), tubeTheme[DIN_R1]);
+      tubes.set(DIN_R2, nowDigits.ones(DATETIME_YEAR), tubeTheme[DIN_R2]);
       break;    
+    case 4: //alarm, hour and minute then 1 for on or 0 for off
+      tubes.set(DIN_L1, alarm.time().hour() / 10, tubeTheme[DIN_L1]);
+      tubes.set(DIN_L2, alarm.time().hour() % 10, tubeTheme[DIN_L2]);
+      tubes.set(DIN1, alarm.time().minute() / 10, tubeTheme[DIN1]);
+      tubes.set(DIN2, alarm.time().minute() % 10, tubeTheme[DIN2]);
+      tubes.set(DIN_R2, alarm.on() ? 1 : 0, tubeTheme[DIN_R2]);
+      break;
   }
-  FastLED.show();
+  renderTubes();
 }
@@ -0,0 +1,103 @@
+/*
+ * Nixie Clock Project
+ * Tube colours for each display theme, converted to RGB once
+ *
+ * Each theme holds a CHSV colour and the CRGB it converts to. set() only runs the HSV to RGB conversion when the
+ * colour actually changes, so the render and animation tasks just copy RGB values. The set mode highlight pulses by
+ * dimming its RGB entry with the same curve hsv2rgb_rainbow() applies to the value, which gives the same colours as
+ * converting CHSV(hue, sat, level) every frame, within one step per channel when FASTLED_SCALE8_FIXED is set.
+ *
+ * Two more entries hold colours worked out from the others, the pulsing highlight level and the blend back from the
+ * set colour, so every tube colour is a palette index and the tubes can be kept as a display list. Each entry has a
+ * bit that is set when its RGB value changes, so the tubes showing it get pushed again.
+ *
+ * Conversions are counted so the stats report can show how many are being done.
+ */
+
+#ifndef Palette_h
+#define Palette_h
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+// Themes
+#define THEME_TIME        0     // Time, the colour picked in the colour editor
+#define THEME_TEMP        1     // Temperature, follows the temperature gradient
+#define THEME_HUMID       2     // Humidity
+#define THEME_DATE        3     // Date
+#define THEME_SET         4     // Fields already set while setting the time
+#define THEME_HIGHLIGHT   5     // Pulsing field being set
+#define THEME_PULSE       6     // THEME_HIGHLIGHT dimmed to the pulse level, RGB only
+#define THEME_BLEND       7     // Blend from THEME_SET back to THEME_TIME after setting the time, RGB only
+#define THEME_COUNT       8     // Changes are tracked in one byte, no more than 8
+
+class Palette {
+  public:
+    //Changes a theme colour, converting it only if it is different
+    void set(uint8_t theme, const CHSV& colour) {
+      CHSV &hsv = _hsv[theme];
+      if((_valid & bit(theme)) && hsv.h == colour.h && hsv.s == colour.s && hsv.v == colour.v)
+        return;
+      hsv = colour;
+      _rgb[theme] = colour;
+      _valid |= bit(theme);
+      _changed |= bit(theme);
+      _conversions++;
+    }
+
+    //Changes a colour worked out in RGB, no conversion
+    void set(uint8_t theme, const CRGB& colour) {
+      if((_valid & bit(theme)) && _rgb[theme] == colour)
+        return;
+      _rgb[theme] = colour;
+      _valid |= bit(theme);
+      _changed |= bit(theme);
+    }
+
+    const CRGB& operator[](uint8_t theme) const {
+      return _rgb[theme];
+    }
+
+    //RGB values in theme order, the colour table for the tubes
+    const CRGB* colours() const {
+      return _rgb;
+    }
+
+    const CHSV& hsv(uint8_t theme) const {
+      return _hsv[theme];
+    }
+
+    //Theme colour at a lower value, same as converting the theme's CHSV with its value scaled by level
+    CRGB dimmed(uint8_t theme, uint8_t level) const {
+      CRGB colour = _rgb[theme];
+      if(level == 255)
+        return colour;
+      uint8_t value = scale8_video(level, level);
+      if(value == 0)
+        return CRGB::Black;
+      return colour.nscale8_video(value);
+    }
+
+    //Conversions done since the last call
+    uint16_t takeConversions() {
+      uint16_t conversions = _conversions;
+      _conversions = 0;
+      return conversions;
+    }
+
+    //Bit per theme whose RGB value changed since the last call
+    uint8_t takeChanged() {
+      uint8_t changed = _changed;
+      _changed = 0;
+      return changed;
+    }
+
+  private:
+    CHSV _hsv[THEME_COUNT];
+    CRGB _rgb[THEME_COUNT];
+    uint8_t _valid = 0;         // Bit per theme, set once it has a colour
+    uint8_t _changed = 0;       // Bit per theme, set when its RGB value changes
+    uint16_t _conversions = 0;
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * Nixie Clock Project
+ * Cooperative task scheduler
+ *
+ * Fixed number of task slots, no heap allocation. Due tasks are kept in a binary min-heap ordered by the time they
+ * are next due, so run() only ever looks at the top of the heap. Periodic tasks are rescheduled from their previous
+ * due time so they don't drift with loop speed. Each periodic task records the longest it has ever taken to run and a
+ * running average of its run time, and the scheduler records the longest single pass of run(), which is the worst
+ * delay any task can see from the others. A one-shot task's slot is free while it runs, so a task that reschedules
+ * itself always finds room.
+ *
+ * The clock is a template parameter so a scheduler can be keyed on millis() or micros(). Times are compared as a
+ * signed difference so the clock rolling over is harmless.
+ */
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <Arduino.h>
+
+#define TASK_NONE         -1     // Returned when there is no free slot
+#define TASK_AVERAGE_SHIFT 3     // Run time average moves 1/8 of the way to each new run
+
+typedef void (*TaskFunction)();
+typedef unsigned long (*TaskClock)();
+
+template<uint8_t CAPACITY, TaskClock CLOCK = millis>
+class Scheduler {
+  public:
+    Scheduler() {
+      for(uint8_t i=0;i<CAPACITY;i++)
+        _tasks[i].fn = NULL;
+    }
+
+    //Runs fn every period ticks of the clock, first run after firstDelay
+    int8_t every(unsigned long period, TaskFunction fn, const __FlashStringHelper* name, unsigned long firstDelay = 0) {
+      return add(period ? period : 1, firstDelay, fn, name);
+    }
+
+    //Runs fn once, delay ticks of the clock from now
+    int8_t after(unsigned long delay, TaskFunction fn, const __FlashStringHelper* name) {
+      return add(0, delay, fn, name);
+    }
+
+    //Removes a task, safe to call from inside the task itself
+    void cancel(int8_t id) {
+      if(!isScheduled(id))
+        return;
+      _tasks[id].fn = NULL;
+      for(uint8_t i=0;i<_size;i++) {
+        if(_heap[i] == id) {
+          removeAt(i);
+          break;
+        }
+      }
+    }
+
+    bool isScheduled(int8_t id) {
+      return id >= 0 && id < CAPACITY && _tasks[id].fn != NULL;
+    }
+
+    //Runs every task that is due, call from loop(). Returns how long the pass took in microseconds, 0 if nothing was due
+    uint16_t run() {
+      unsigned long now = CLOCK();
+      unsigned long passStart = micros();
+      bool ranTask = false;
+      while(_size > 0) {
+        int8_t id = _heap[0];
+        Task &task = _tasks[id];
+        if((long)(now - task.due) < 0)
+          break;
+        removeAt(0);
+
+        TaskFunction fn = task.fn;
+        bool oneShot = task.period == 0;
+        if(oneShot)
+          task.fn = NULL; //One-shot, the slot can be reused from inside fn, even by the task itself
+        _running = id;
+        _readded = false;
+        unsigned long start = micros();
+        fn();
+        unsigned long elapsed = micros() - start;
+        _running = TASK_NONE;
+        ranTask = true;
+
+        if(oneShot || _readded || task.fn == NULL)
+          continue; //One-shot, or cancelled while running, the slot may already hold a task added by fn
+        uint16_t us = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+        if(us > task.worst)
+          task.worst = us;
+        task.typical += ((int32_t)us - task.typical) >> TASK_AVERAGE_SHIFT;
+        task.due += task.period;
+        if((long)(CLOCK() - task.due) >= 0)
+          task.due = CLOCK() + task.period; //Fell a whole period behind, skip the missed runs
+        push(id);
+      }
+      if(ranTask) {
+        unsigned long pass = micros() - passStart;
+        if(pass > 0xFFFF)
+          pass = 0xFFFF;
+        if(pass > _worstPass)
+          _worstPass = pass;
+        return pass;
+      }
+      return 0;
+    }
+
+    //Longest run of a periodic task in microseconds, saturates at 65535
+    uint16_t worstCase(int8_t id) {
+      return isScheduled(id) ? _tasks[id].worst : 0;
+    }
+
+    //Running average run time of a periodic task in microseconds
+    uint16_t typical(int8_t id) {
+      return isScheduled(id) ? _tasks[id].typical : 0;
+    }
+
+    //Longest single call of run() in microseconds, saturates at 65535
+    uint16_t worstPass() {
+      return _worstPass;
+    }
+
+    const __FlashStringHelper* name(int8_t id) {
+      return isScheduled(id) ? _tasks[id].name : NULL;
+    }
+
+    void resetStats() {
+      for(uint8_t i=0;i<CAPACITY;i++) {
+        _tasks[i].worst = 0;
+        _tasks[i].typical = 0;
+      }
+      _worstPass = 0;
+    }
+
+    uint8_t capacity() {
+      return CAPACITY;
+    }
+
+  private:
+    struct Task {
+      TaskFunction fn;                  // NULL when the slot is free
+      const __FlashStringHelper* name;  // For reports
+      unsigned long due;                // Clock value the task is next due at
+      unsigned long period;             // 0 for one-shot tasks
+      uint16_t worst;                   // Longest run in us
+      uint16_t typical;                 // Average run in us, 1/8 weight per run
+    };
+
+    Task    _tasks[CAPACITY];
+    int8_t  _heap[CAPACITY];            // Task slots ordered by due time
+    uint8_t _size = 0;
+    int8_t  _running = TASK_NONE;
+    bool    _readded = false;           // The running task's slot was given to a new task
+    uint16_t _worstPass = 0;
+
+    int8_t add(unsigned long period, unsigned long delay, TaskFunction fn, const __FlashStringHelper* name) {
+      for(int8_t id=0;id<CAPACITY;id++) {
+        if(_tasks[id].fn != NULL)
+          continue;
+        if(id == _running)
+          _readded = true;
+        _tasks[id].fn = fn;
+        _tasks[id].name = name;
+        _tasks[id].due = CLOCK() + delay;
+        _tasks[id].period = period;
+        _tasks[id].worst = 0;
+        _tasks[id].typical = 0;
+        push(id);
+        return id;
+      }
+      return TASK_NONE;
+    }
+
+    bool earlier(uint8_t a, uint8_t b) {
+      return (long)(_tasks[_heap[a]].due - _tasks[_heap[b]].due) < 0;
+    }
+
+    void swap(uint8_t a, uint8_t b) {
+      int8_t t = _heap[a];
+      _heap[a] = _heap[b];
+      _heap[b] = t;
+    }
+
+    void push(int8_t id) {
+      uint8_t i = _size++;
+      _heap[i] = id;
+      while(i > 0 && earlier(i, (i - 1) / 2)) {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+      }
+    }
+
+    void removeAt(uint8_t i) {
+      _heap[i] = _heap[--_size];
+      while(i > 0 && earlier(i, (i - 1) / 2)) { //Moved up
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+      }
+      for(;;) { //Moved down
+        uint8_t child = 2 * i + 1;
+        if(child >= _size)
+          break;
+        if(child + 1 < _size && earlier(child + 1, child))
+          child++;
+        if(!earlier(child, i))
+          break;
+        swap(i, child);
+        i = child;
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Nixie Clock Project
+ * Binary trace log for instrumenting the sketch on the board
+ *
+ * Serial shares pins 0/1 with the DIN_R1/DIN_R2 tube data, so the sketch can't print as it runs. Instead events go
+ * into a ring of fixed size records: the low 16 bits of millis(), an event id and a 16 bit value. Logging is a few
+ * stores and the oldest record is overwritten once the ring is full, so it can stay in the finished sketch.
+ *
+ * dump() writes the ring out oldest first and save() copies the newest records into a block small enough for the RTC
+ * SRAM. Both are a TraceHeader followed by the records, little endian, so tools/decode_trace.py reads either and
+ * turns them into a timeline and latency histograms.
+ *
+ * Event ids and what their values mean are up to the sketch. log() is not safe to call from an ISR.
+ */
+
+#ifndef Trace_h
+#define Trace_h
+
+#include <Arduino.h>
+
+#define TRACE_MAGIC       'T'   // First byte of every block
+#define TRACE_LIVE        'R'   // Block dumped from the ring
+#define TRACE_SAVED       'S'   // Block saved earlier, usually read back from the RTC SRAM
+
+struct TraceRecord {
+  uint16_t time;                // Low 16 bits of millis()
+  uint8_t event;
+  uint16_t value;
+} __attribute__((packed));
+
+struct TraceHeader {
+  uint8_t magic;                // TRACE_MAGIC
+  uint8_t kind;                 // TRACE_LIVE or TRACE_SAVED
+  uint8_t count;                // Records that follow
+};
+
+// Header and room for N records, as stored in the RTC SRAM
+template<uint8_t N>
+struct TraceBlock {
+  TraceHeader header;
+  TraceRecord records[N];
+
+  bool valid() const {
+    return header.magic == TRACE_MAGIC && header.kind == TRACE_SAVED && header.count <= N;
+  }
+
+  //Bytes in use, the header and the records it holds
+  uint8_t size() const {
+    return sizeof(TraceHeader) + header.count * sizeof(TraceRecord);
+  }
+};
+
+template<uint8_t RECORDS>
+class Trace {
+  public:
+    static_assert(RECORDS > 0 && RECORDS <= 128 && (RECORDS & (RECORDS - 1)) == 0,
+                  "The ring must be a power of 2, at most 128 records");
+
+    //Adds a record, overwriting the oldest once the ring is full
+    void log(uint8_t event, uint16_t value = 0) {
+      TraceRecord &record = _records[_head];
+      record.time = millis();
+      record.event = event;
+      record.value = value;
+      _head = (_head + 1) & (RECORDS - 1);
+      if(_count < RECORDS)
+        _count++;
+    }
+
+    uint8_t count() const {
+      return _count;
+    }
+
+    void clear() {
+      _count = 0;
+    }
+
+    //Writes a TRACE_LIVE block of every record, oldest first, to anything with write(const uint8_t*, size_t)
+    template<class OUT>
+    void dump(OUT &out) const {
+      TraceHeader header = { TRACE_MAGIC, TRACE_LIVE, _count };
+      out.write((const uint8_t*)&header, sizeof(header));
+      uint8_t index = (_head - _count) & (RECORDS - 1);
+      for(uint8_t i=0;i<_count;i++) {
+        out.write((const uint8_t*)&_records[index], sizeof(TraceRecord));
+        index = (index + 1) & (RECORDS - 1);
+      }
+    }
+
+    //Fills a TRACE_SAVED block with the newest records, oldest first
+    template<uint8_t N>
+    void save(TraceBlock<N> &block) const {
+      uint8_t count = _count < N ? _count : N;
+      block.header.magic = TRACE_MAGIC;
+      block.header.kind = TRACE_SAVED;
+      block.header.count = count;
+      uint8_t index = (_head - count) & (RECORDS - 1);
+      for(uint8_t i=0;i<count;i++) {
+        block.records[i] = _records[index];
+        index = (index + 1) & (RECORDS - 1);
+      }
+    }
+
+  private:
+    TraceRecord _records[RECORDS];
+    uint8_t _head = 0;          // Next record to write
+    uint8_t _count = 0;         // Records held, up to RECORDS
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+* TTSi7006
+* Version 1.0 July, 2017
+* Copyright 2017 TOLDO TECHNIK
+* For more details, see https://github.com/TOLDOTECHNIK/TTSi7006
+*/
+
+#include "TTSi7006.h"
+
+TTSi7006::TTSi7006(boolean wireBegin){
+  if(wireBegin){
+    Wire.begin();
+  }
+}
+
+boolean TTSi7006::isConnected(){
+  Wire.beginTransmission(TTSi7006_I2C_ADDRESS);
+  return !Wire.endTransmission();
+}
+
+float TTSi7006::readHumidity(){
+  float humidity = 0;
+
+  Wire.beginTransmission(TTSi7006_I2C_ADDRESS);
+  Wire.write(TTSi7006_REG_REL_HUM);
+  Wire.endTransmission();
+  Wire.requestFrom(TTSi7006_I2C_ADDRESS, (byte)2);
+
+  if(Wire.available() > 1){
+    humidity = Wire.read() * 256.0 + Wire.read();
+    humidity = ((125 * humidity) / 65536.0) - 6;
+  }
+  return humidity;
+}
+
+float TTSi7006::readTemperatureC(){
+  float temperature = 0;
+
+  Wire.beginTransmission(TTSi7006_I2C_ADDRESS);
+  Wire.write(TTSi7006_REG_TEMP);
+  Wire.endTransmission();
+  Wire.requestFrom(TTSi7006_I2C_ADDRESS, (byte)2);
+
+  if(Wire.available() > 1){
+    temperature = Wire.read() * 256.0 + Wire.read();
+    temperature = ((175.72 * temperature) / 65536.0) - 46.85;
+  }
+
+  return temperature;
+}
+
+float TTSi7006::readTemperatureF(){
+  return readTemperatureC() * 1.8 + 32;
+}
+
+
+//Sends the RH measurement command without holding the clock line, the Si7006
+//measures temperature as part of every RH conversion
+boolean TTSi7006::startMeasurement(){
+  Wire.beginTransmission(TTSi7006_I2C_ADDRESS);
+  Wire.write(TTSi7006_REG_REL_HUM_NO_HOLD);
+  return !Wire.endTransmission();
+}
+
+//Fetches the result of startMeasurement(), the sensor NACKs the read while
+//the conversion is still running
+boolean TTSi7006::readMeasurement(uint16_t &rawHumidity, uint16_t &rawTemperature){
+  if(Wire.requestFrom(TTSi7006_I2C_ADDRESS, (byte)2) < 2){
+    return false;
+  }
+  rawHumidity = Wire.read() << 8;
+  rawHumidity |= Wire.read();
+
+  Wire.beginTransmission(TTSi7006_I2C_ADDRESS);
+  Wire.write(TTSi7006_REG_TEMP_PREVIOUS);
+  Wire.endTransmission();
+  if(Wire.requestFrom(TTSi7006_I2C_ADDRESS, (byte)2) < 2){
+    return false;
+  }
+  rawTemperature = Wire.read() << 8;
+  rawTemperature |= Wire.read();
+  return true;
+}
+
+//Runs the background measurement one step at a time. Starts a conversion
+//every interval, checks for the result once the conversion time has passed
+//and folds it into the smoothed readings. Returns true when a new reading
+//was published
+boolean TTSi7006::update(){
+  unsigned long now = millis();
+  if(!_converting){
+    if(_started && now - _startTime < _interval){
+      return false;
+    }
+    _started = true;
+    _startTime = now;
+    _converting = startMeasurement();
+    return false;
+  }
+
+  if(now - _startTime < TTSi7006_CONVERSION_TIME){
+    return false;
+  }
+  uint16_t rawHumidity, rawTemperature;
+  if(!readMeasurement(rawHumidity, rawTemperature)){
+    if(now - _startTime > TTSi7006_CONVERSION_TIMEOUT){
+      _converting = false; //Try again next interval
+    }
+    return false;
+  }
+  _converting = false;
+
+  float humidity = ((125 * (float)rawHumidity) / 65536.0) - 6;
+  float temperature = ((175.72 * (float)rawTemperature) / 65536.0) - 46.85;
+  if(!_hasReading){
+    _humidity = humidity;
+    _temperature = temperature;
+  } else {
+    _humidity += (humidity - _humidity) / 4;
+    _temperature += (temperature - _temperature) / 4;
+  }
+  _readingTime = now;
+  _hasReading = true;
+  return true;
+}
+
+void TTSi7006::setInterval(unsigned long interval){
+  _interval = interval;
+}
+
+//True once update() has published at least one reading
+boolean TTSi7006::hasReading(){
+  return _hasReading;
+}
+
+//Smoothed relative humidity in % from the background measurement
+float TTSi7006::humidity(){
+  return _humidity;
+}
+
+//Smoothed temperature in °C from the background measurement
+float TTSi7006::temperatureC(){
+  return _temperature;
+}
+
+//millis() when the last background reading was published
+unsigned long TTSi7006::readingTime(){
+  return _readingTime;
+}
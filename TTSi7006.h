@@ -0,0 +1,65 @@
+/*
+* TTSi7006
+* Version 1.0 July, 2017
+* Copyright 2017 TOLDO TECHNIK
+* For more details, see https://github.com/TOLDOTECHNIK/TTSi7006
+*
+* Non official branch by CFraser: added a non-blocking measurement using the
+* "No Hold Master Mode" commands so a conversion doesn't stall the I2C bus
+*/
+
+#ifndef TTSi7006_H
+#define TTSi7006_H
+
+#include <Wire.h>
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <Wprogram.h>
+#endif
+
+//CONSTANTS
+#define TTSi7006_I2C_ADDRESS              0x40
+#define TTSi7006_ID                       0x186
+
+#define TTSi7006_REG_REL_HUM              0xE5
+#define TTSi7006_REG_TEMP                 0xE3
+#define TTSi7006_REG_REL_HUM_NO_HOLD      0xF5
+#define TTSi7006_REG_TEMP_PREVIOUS        0xE0
+
+#define TTSi7006_CONVERSION_TIME          23    //ms, worst case RH plus temperature conversion
+#define TTSi7006_CONVERSION_TIMEOUT       100   //ms, give up on a conversion after this long
+#define TTSi7006_DEFAULT_INTERVAL         2000  //ms between background measurements
+
+class TTSi7006{
+  public:
+    TTSi7006(boolean wireBegin);
+
+    boolean isConnected();
+    float readHumidity();
+    float readTemperatureC();
+    float readTemperatureF();
+
+    //Non-blocking measurement, call update() every loop
+    boolean update();
+    void setInterval(unsigned long interval);
+    boolean hasReading();
+    float humidity();
+    float temperatureC();
+    unsigned long readingTime();
+   
+  private:
+    boolean startMeasurement();
+    boolean readMeasurement(uint16_t &rawHumidity, uint16_t &rawTemperature);
+
+    boolean _started = false;
+    boolean _converting = false;
+    boolean _hasReading = false;
+    unsigned long _interval = TTSi7006_DEFAULT_INTERVAL;
+    unsigned long _startTime = 0;
+    unsigned long _readingTime = 0;
+    float _humidity = 0;
+    float _temperature = 0;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Nixie Clock Project
+ * Temperature to colour gradient shared by the NixieClock and TempIndicator sketches
+ * Colin Fraser
+ *
+ * A gradient is described by a list of (temperature, hue, saturation) control points in rising temperature order.
+ * At compile time the points are expanded into a table in flash with one entry per quarter degree, linearly
+ * interpolated between the points, so a lookup is one clamped index and one word read from flash. Temperatures
+ * outside the first and last points use the end colours.
+ *
+ * Like MCP7940.h this needs to be copied into the Arduino libraries folder for the sketches to find it.
+ */
+
+#ifndef TempGradient_h
+#define TempGradient_h
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#define GRADIENT_STEPS_PER_DEGREE 4
+
+// Control point temperature in table steps
+#define GRADIENT_DEGREES(d) ((int16_t)((d) * GRADIENT_STEPS_PER_DEGREE))
+
+struct GradientPoint {
+  int16_t temp;   // Quarter degrees C
+  uint8_t hue;
+  uint8_t sat;
+};
+
+// Colours used by the clock since the first version, hard clamped below 15 and from 30 degrees
+constexpr GradientPoint clockGradient[] = {
+  { GRADIENT_DEGREES(15), 140,  40 },
+  { GRADIENT_DEGREES(16),  70, 118 },
+  { GRADIENT_DEGREES(17),  30, 160 },
+  { GRADIENT_DEGREES(18),  29, 185 },
+  { GRADIENT_DEGREES(19),  27, 210 },
+  { GRADIENT_DEGREES(20),  26, 200 },
+  { GRADIENT_DEGREES(21),  26, 225 },
+  { GRADIENT_DEGREES(22),  26, 255 },
+  { GRADIENT_DEGREES(23),  15, 255 },
+  { GRADIENT_DEGREES(24),  11, 255 },
+  { GRADIENT_DEGREES(25),   9, 255 },
+  { GRADIENT_DEGREES(26),   7, 255 },
+  { GRADIENT_DEGREES(27),   5, 255 },
+  { GRADIENT_DEGREES(28),   3, 255 },
+  { GRADIENT_DEGREES(29),   2, 255 },
+  { GRADIENT_DEGREES(30),   0, 255 }
+};
+
+// The indicator stays cold blue until it shows 35 degrees, then hot orange. Looked up with the whole degrees on the
+// tubes, so the colour never changes before the digits do
+constexpr GradientPoint indicatorGradient[] = {
+  { GRADIENT_DEGREES(34), 135, 210 },
+  { GRADIENT_DEGREES(35),  14, 255 }
+};
+
+// Compile time helpers, C++11 constexpr functions have to be a single return statement
+
+//Index of the control point starting the segment that holds temp
+constexpr uint8_t gradientSegment(const GradientPoint* points, uint8_t count, int16_t temp, uint8_t i = 0) {
+  return (i + 2 >= count || temp < points[i + 1].temp) ? i : gradientSegment(points, count, temp, i + 1);
+}
+
+//Rounded linear interpolation from a at t0 to b at t1
+constexpr uint8_t gradientLerp(uint8_t a, uint8_t b, int16_t t, int16_t t0, int16_t t1) {
+  return (int16_t)a + (((int32_t)b - a) * (t - t0) * 2 + ((b >= a) ? (t1 - t0) : -(t1 - t0))) / ((t1 - t0) * 2);
+}
+
+constexpr uint16_t gradientPack(const GradientPoint& p0, const GradientPoint& p1, int16_t temp) {
+  return ((uint16_t)gradientLerp(p0.hue, p1.hue, temp, p0.temp, p1.temp) << 8) |
+         gradientLerp(p0.sat, p1.sat, temp, p0.temp, p1.temp);
+}
+
+//Table entry for one step, hue in the high byte and saturation in the low byte
+constexpr uint16_t gradientEntry(const GradientPoint* points, uint8_t count, int16_t temp) {
+  return gradientPack(points[gradientSegment(points, count, temp)],
+                      points[gradientSegment(points, count, temp) + 1], temp);
+}
+
+template<int... I> struct GradientIndices {};
+template<int N, int... I> struct MakeGradientIndices : MakeGradientIndices<N - 1, N - 1, I...> {};
+template<int... I> struct MakeGradientIndices<0, I...> { typedef GradientIndices<I...> type; };
+
+template<const GradientPoint* POINTS, uint8_t COUNT, class INDICES> struct GradientTable;
+template<const GradientPoint* POINTS, uint8_t COUNT, int... I>
+struct GradientTable<POINTS, COUNT, GradientIndices<I...> > {
+  static const uint16_t entries[sizeof...(I)];
+};
+template<const GradientPoint* POINTS, uint8_t COUNT, int... I>
+const uint16_t GradientTable<POINTS, COUNT, GradientIndices<I...> >::entries[sizeof...(I)] PROGMEM = {
+  gradientEntry(POINTS, COUNT, POINTS[0].temp + I)...
+};
+
+template<const GradientPoint* POINTS, uint8_t COUNT>
+class TempGradient {
+  public:
+    static_assert(COUNT >= 2, "A gradient needs at least two control points");
+
+    //Colour for a temperature in quarter degrees
+    static CHSV lookup(int16_t steps) {
+      if(steps < FIRST)
+        steps = FIRST;
+      else if(steps > LAST)
+        steps = LAST;
+      uint16_t entry = pgm_read_word(Table::entries + (steps - FIRST));
+      return CHSV(entry >> 8, entry & 0xFF, 255);
+    }
+
+    //Colour for a temperature in degrees C
+    static CHSV lookup(float degrees) {
+      return lookup((int16_t)lround(degrees * GRADIENT_STEPS_PER_DEGREE));
+    }
+
+  private:
+    static constexpr int16_t FIRST = POINTS[0].temp;
+    static constexpr int16_t LAST = POINTS[COUNT - 1].temp;
+    typedef GradientTable<POINTS, COUNT, typename MakeGradientIndices<LAST - FIRST + 1>::type> Table;
+
+  public:
+    static constexpr uint16_t TABLE_BYTES = (LAST - FIRST + 1) * sizeof(uint16_t);  // Flash taken by the table
+};
+
+#define GRADIENT_POINTS(points) sizeof(points) / sizeof(points[0])
+
+typedef TempGradient<clockGradient, GRADIENT_POINTS(clockGradient)> ClockGradient;
+typedef TempGradient<indicatorGradient, GRADIENT_POINTS(indicatorGradient)> IndicatorGradient;
+
+#endif
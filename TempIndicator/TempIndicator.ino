@@ -11,6 +11,8 @@
 #include <TTSi7006.h>
 #include <FastLED.h>
 #include <MCP7940.h>
+#include <TempGradient.h>
+#include <TubeDisplay.h>
 #include <math.h>
 
 //constants
@@ -35,6 +37,7 @@
 #define CLAP_MIN_TIME     200 //ms
 #define CLAP_MAX_TIME     800 //ms
 #define SET_TIMEOUT       30000 // 30s timeout if no activity
+#define SENSOR_PERIOD     1000  //ms between temperature readings, slow enough that it doesn't look like it's freaking out at the border of 2 numbers
 
 // Non numerical LED locations
 //#define TEMP_SYMB       0 //needs updating
@@ -49,33 +52,27 @@
 //Trim value set to -180 clock cycles every minute
 
 
-#define NUM_LEDS          10
-#define NUM_STRIPS        6
+#define NUM_LEDS          10    // LEDs behind each tube
 
-#define DIN_L1_PIN        6 // Which pin this is hooked up to
-#define DIN_L1            0 // Index in the array of where this is kept
-
-#define DIN_L2_PIN        7
-#define DIN_L2            1
-
-#define DIN1_PIN          5
-#define DIN1              2
+// Only the two digit tubes are fitted, the other positions are left over from the clock and never lit
+#define DIN1_PIN          5 // Which pin this is hooked up to
+#define DIN1              0 // Index in the array of where this is kept
 
 #define DIN2_PIN          4
-#define DIN2              3
+#define DIN2              1
 
-#define DIN_R1_PIN        0
+#define DIN_L1            2
+#define DIN_L2            3
 #define DIN_R1            4
-
-#define DIN_R2_PIN        1
 #define DIN_R2            5
 
 #define LED_TYPE          WS2812B
 #define COLOR_ORDER       GRB
 #define MAX_BRIGHTNESS        255
 
-// Define the 2D array of LEDs and strips
-CRGB leds[NUM_STRIPS][NUM_LEDS];
+typedef TubeStrips<LED_TYPE, COLOR_ORDER, NUM_LEDS, nullptr, DIN1_PIN, DIN2_PIN> Tubes;
+
+Tubes tubes;
 
 const uint8_t  SPRINTF_BUFFER_SIZE =     32;                                  // Buffer size for sprintf()        //
 
@@ -167,13 +164,9 @@ void setup() {
 
   Serial.print("Si7006 is connected: ");
   Serial.println(si7006.isConnected() ? "Yes" : "No");
+  si7006.setInterval(SENSOR_PERIOD);
 
-  FastLED.addLeds<LED_TYPE, DIN_L1_PIN, COLOR_ORDER>(leds[DIN_L1], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN_L2_PIN, COLOR_ORDER>(leds[DIN_L2], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN1_PIN, COLOR_ORDER>(leds[DIN1], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN2_PIN, COLOR_ORDER>(leds[DIN2], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN_R1_PIN, COLOR_ORDER>(leds[DIN_R1], NUM_LEDS);
-  FastLED.addLeds<LED_TYPE, DIN_R2_PIN, COLOR_ORDER>(leds[DIN_R2], NUM_LEDS);
+  tubes.begin();
 
   for(int i=0; i < 6; i++)
     colours[i] = defaultOrange;
@@ -187,20 +180,6 @@ void loop() {
   currentStateMODE = digitalRead(SW_MODE_PIN);
   currentStateATHRESH = digitalRead(ATHRESH_PIN);
   
-//
-//  //SET Button - Long or short press
-//  if(lastStateSET == LOW && currentStateSET == HIGH)        // button is pressed
-//    pressedTimeSET = millis();
-//  else if(lastStateSET == HIGH && currentStateSET == LOW) { // button is released
-//    releasedTimeSET = millis();
-//
-//    long pressDuration = releasedTimeSET - pressedTimeSET;
-//
-//    if( pressDuration < SHORT_PRESS_TIME ) 
-//      setShortPress();//Serial.println("SET - SHORT PRESS");
-//    else
-//      setLongPress();//Serial.println("SET - LONG PRESS");
-//  }
 //
 //  static bool isBright = 0;
 //  if(lastStateMODE == LOW && currentStateMODE == HIGH)    // button is pressed
@@ -305,11 +284,13 @@ void loop() {
 //      printTime();                                            // Display the current date/time    //
 
       //TEMP INDICATOR version just stays in displayIndex=1 (Temperature)
-      displayIndex = 1;
-      currTemp = round( si7006.readTemperatureC() ); //Calibration looked pretty solid
-      updateColours();
-      updateLEDs();
-      delay(1000); //1s delay so it doesn't look like it's freaking out when at the border of 2 numbers
+      //Readings come from the background measurement, the tubes are only updated when a new one arrives
+      if(si7006.update()) {
+        displayIndex = 1;
+        currTemp = round( si7006.temperatureC() ); //Calibration looked pretty solid
+        updateColours();
+        updateLEDs();
+      }
 //    }
 //    
 //  }
@@ -379,89 +360,6 @@ void loop() {
 
 }
 
-void setShortPress() {
-  if(setTimeIndex > 0) {
-    setTimeIndex++;
-    //Serial specific
-    switch(setTimeIndex) {
-      case 1: //Impossible
-        Serial.println("Set Hour");
-        timeChange = TimeSpan(0,1,0,0);
-        break;
-      case 2:
-        colours[DIN_L1] = defaultOrange;
-        colours[DIN_L2] = defaultOrange;
-        colours[DIN1] = CRGB::Indigo;
-        colours[DIN2] = CRGB::Indigo;
-        Serial.println("Set Minute");
-        timeChange = TimeSpan(0,0,1,0);
-        break;
-      case 3:
-        colours[DIN1] = defaultOrange;
-        colours[DIN2] = defaultOrange;
-        colours[DIN_R1] = CRGB::Indigo;
-        colours[DIN_R2] = CRGB::Indigo;
-        Serial.println("Set Second");
-        timeChange = TimeSpan(0,0,0,1);
-        break;
-      case 4:
-//        colours[DIN_R1] = defaultOrange;
-//        colours[DIN_R2] = defaultOrange;CHSV(96,200,255)
-        colours[DIN_R1] = CHSV(76,255,255);
-        colours[DIN_R2] = CHSV(76,255,255);
-        colours[DIN1] = CHSV(76,255,255);
-        colours[DIN2] = CHSV(76,255,255);
-        colours[DIN_L1] = CRGB::Indigo;
-        colours[DIN_L2] = CRGB::Indigo;
-        Serial.println("Set Month");
-        displayIndex = 3;
-        break;
-      case 5:
-        colours[DIN_L1] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN_L2] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN1] = CRGB::Indigo;
-        colours[DIN2] = CRGB::Indigo;
-        Serial.println("Set Day");
-        timeChange = TimeSpan(1,0,0,0);
-        break;
-      case 6:
-        colours[DIN1] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN2] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN_R1] = CRGB::Indigo;
-        colours[DIN_R2] = CRGB::Indigo;
-        Serial.println("Set Year");
-        break;
-      case 7:
-        colours[DIN_R1] = CHSV(76,255,255);//defaultOrange;
-        colours[DIN_R2] = CHSV(76,255,255);//defaultOrange;
-        Serial.println("Finished Setting");
-        //displayIndex = 0;
-        transitionFlag = 1;
-        transitionValue = 0;
-        setTimeIndex = 0;
-        MCP7940.adjust(now);
-        break;
-    }
-
-  }
-}
-
-void setLongPress() {
-  if(setTimeIndex == 0) {
-    colours[DIN_L1] = CRGB::Indigo;
-    colours[DIN_L2] = CRGB::Indigo;
-    setTimeIndex = 1;
-    Serial.println("Set Hour");
-    timeChange = TimeSpan(0,1,0,0);
-  } else {
-    for(int i=0;i<6;i++)
-    colours[i] = defaultOrange;
-    displayIndex = 0;
-    setTimeIndex = 0;
-    MCP7940.adjust(now);
-  }
-}
-
 void modePress() {
   //cycleDisplay();
 }
@@ -475,8 +373,8 @@ void printTime() {
 //Kicks off the fade flag which begins cycling through temp/humid/date displays
 void cycleDisplay() {
   if(setTimeIndex == 0) { //DO NOT want to start cycling while you're in the middle of setting the time
-    currTemp = round( si7006.readTemperatureC() ); //calibrated with temperature oven, seems accurate
-    currHumid = round( si7006.readHumidity() );
+    currTemp = round( si7006.temperatureC() ); //calibrated with temperature oven, seems accurate
+    currHumid = round( si7006.humidity() );
     fadeFlag = 1;
   }
 }
@@ -488,57 +386,7 @@ void updateColours() {
       colours[i] = defaultOrange;     
            
   } else if(displayIndex == 1) { //temp could adjust based on temp
-    CRGB tempCol = CRGB::White;
-    if(currTemp >= 35) //35 and over makes the indicator show as HOT
-      tempCol = CHSV(14,255,255); //Hot Orangey
-    else //if(currTemp <= 20)
-      tempCol = CHSV(135,210,255); //Cold Bluey
-//    else {
-//      switch(currTemp) {
-//        case 47:
-//          tempCol = CHSV(2,255,255);
-//          break;
-//        case 45:
-//          tempCol = CHSV(3,255,255);
-//          break;
-//        case 43:
-//          tempCol = CHSV(5,255,255);
-//          break;
-//        case 41:
-//          tempCol = CHSV(7,255,255);
-//          break;
-//        case 39:
-//          tempCol = CHSV(9,255,255);
-//          break;
-//        case 37:
-//          tempCol = CHSV(11,255,255);
-//          break;
-//        case 35:
-//          tempCol = CHSV(15,255,255);
-//          break;
-//        case 33:
-//          tempCol = CHSV(26,255,255);
-//          break;
-//        case 31:
-//          tempCol = CHSV(26,225,255);
-//          break;
-//        case 29:
-//          tempCol = CHSV(26,200,255);
-//          break;
-//        case 27:
-//          tempCol = CHSV(27,210,255);
-//          break;
-//        case 25:
-//          tempCol = CHSV(29,185,255);
-//          break;
-//        case 23:
-//          tempCol = CHSV(30,160,255);
-//          break;
-//        case 21:
-//          tempCol = CHSV(70,118,255);
-//          break;
-//      }
-//    }
+    CRGB tempCol = IndicatorGradient::lookup(GRADIENT_DEGREES(currTemp)); //Bluey until it shows 35, then HOT orangey
     for(int i=0;i<6;i++)
       colours[i] = tempCol;
       
@@ -555,39 +403,39 @@ void updateColours() {
 
 //Updates the tube LEDs
 void updateLEDs() {
-  FastLED.clear();
+  tubes.clear();
   switch(displayIndex) {
     case 0: //time
-      leds[DIN_L1][now.hour() / 10] = colours[DIN_L1];
-      leds[DIN_L2][now.hour() % 10] = colours[DIN_L2];
-      leds[DIN1][now.minute() / 10] = colours[DIN1];
-      leds[DIN2][now.minute() % 10] = colours[DIN2];
-      leds[DIN_R1][now.second() / 10] = colours[DIN_R1];
-      leds[DIN_R2][now.second() % 10] = colours[DIN_R2];
+      tubes.set(DIN_L1, now.hour() / 10, DIN_L1);
+      tubes.set(DIN_L2, now.hour() % 10, DIN_L2);
+      tubes.set(DIN1, now.minute() / 10, DIN1);
+      tubes.set(DIN2, now.minute() % 10, DIN2);
+      tubes.set(DIN_R1, now.second() / 10, DIN_R1);
+      tubes.set(DIN_R2, now.second() % 10, DIN_R2);
       break;
     case 1: //temp
       if(currTemp < 0)
-        leds[DIN_L1][MINUS_SYMB] = colours[DIN_L1];
+        tubes.set(DIN_L1, MINUS_SYMB, DIN_L1);
       if(abs(currTemp) >= 100)
-        leds[DIN_L2][abs(currTemp) / 100] = colours[DIN_L2];
-      leds[DIN1][(abs(currTemp)/10) % 10] = colours[DIN1];
-      leds[DIN2][abs(currTemp) % 10] = colours[DIN2];
-      leds[DIN_R1][currUnit] = colours[DIN_R1];
+        tubes.set(DIN_L2, abs(currTemp) / 100, DIN_L2);
+      tubes.set(DIN1, (abs(currTemp)/10) % 10, DIN1);
+      tubes.set(DIN2, abs(currTemp) % 10, DIN2);
+      tubes.set(DIN_R1, currUnit, DIN_R1);
       break;      
     case 2: //humid
-      leds[DIN_L1][RH_SYMB] = colours[DIN_L1];
-      leds[DIN1][currHumid / 10] = colours[DIN1];
-      leds[DIN2][currHumid % 10] = colours[DIN2];
-      leds[DIN_R1][PCNT_SYMB] = colours[DIN_L1];
+      tubes.set(DIN_L1, RH_SYMB, DIN_L1);
+      tubes.set(DIN1, currHumid / 10, DIN1);
+      tubes.set(DIN2, currHumid % 10, DIN2);
+      tubes.set(DIN_R1, PCNT_SYMB, DIN_L1);
       break;
     case 3: //date
-      leds[DIN_L1][now.month() / 10] = colours[DIN_L1];
-      leds[DIN_L2][now.month() % 10] = colours[DIN_L2];
-      leds[DIN1][now.day() / 10] = colours[DIN1];
-      leds[DIN2][now.day() % 10] = colours[DIN2];
-      leds[DIN_R1][(now.year()/10) % 10] = colours[DIN_R1];
-      leds[DIN_R2][now.year() % 10] = colours[DIN_R2];
+      tubes.set(DIN_L1, now.month() / 10, DIN_L1);
+      tubes.set(DIN_L2, now.month() % 10, DIN_L2);
+      tubes.set(DIN1, now.day() / 10, DIN1);
+      tubes.set(DIN2, now.day() % 10, DIN2);
+      tubes.set(DIN_R1, (now.year()/10) % 10, DIN_R1);
+      tubes.set(DIN_R2, now.year() % 10, DIN_R2);
       break;    
   }
-  FastLED.show();
+  tubes.show(FastLED.getBrightness(), colours);
 }
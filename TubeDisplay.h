@@ -0,0 +1,249 @@
+/*
+ * Nixie Clock Project
+ * Compile time description of the tubes and how their LEDs are wired
+ * Colin Fraser
+ *
+ * Each tube is lit by a short strip of addressable LEDs, one LED behind each digit or symbol, and only one of them is
+ * ever on. So the display is kept as a display list, one digit and one colour index per tube, and is only expanded
+ * into CRGB values inside show(), a tube at a time, just before it is pushed. The colour index picks an entry in a
+ * table the sketch hands to show(), its palette.
+ *
+ * A display type gives the LED chipset and colour order, the LEDs per tube, an optional digit to LED map in flash
+ * and the data pins, and from that registers the FastLED controllers and pushes only the tubes that changed:
+ *
+ *   TubeStrips<WS2812B, GRB, 10, nullptr, 6, 7, 5, 4>   four tubes, each on its own data pin, left to right
+ *   TubeChain<WS2812B, GRB, 10, nullptr, 4, 6>          four tubes daisy chained from pin 6, one controller and one push
+ *
+ * The strips share one tube's worth of LEDs, every controller is pointed at the same buffer and it is refilled before
+ * each push. A chain is pushed in one go so it needs LEDs for every tube. Either way nothing else should call
+ * FastLED.show(), it would push whatever happens to be in the buffer.
+ *
+ * With setCrossfade() a tube that changes digit fades from the old one to the new one instead of switching. The tube
+ * keeps the digit it is leaving next to the one it is showing, and both are lit in the same colour split by an 8 bit
+ * level, one scale8() per channel giving both LEDs, so the pair never looks brighter or dimmer than one digit. Fading
+ * tubes are pushed every show() until the fade is done.
+ *
+ * Tubes are numbered from 0 in the order given. A sketch can name more tube positions than are fitted, anything at
+ * or past TUBES is quietly not lit, so the same drawing code works on a board with fewer tubes.
+ *
+ * Like MCP7940.h this needs to be copied into the Arduino libraries folder for the sketches to find it.
+ */
+
+#ifndef TubeDisplay_h
+#define TubeDisplay_h
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#define TUBE_BLANK        0xFF  // Digit for a tube with nothing lit
+#define TUBE_ALL_COLOURS  0xFF  // Every colour in the table may have changed
+
+// Registers one controller per pin, all on the same LEDs
+template<template<uint8_t, EOrder> class CHIPSET, EOrder ORDER, uint8_t LEDS, uint8_t... PINS> struct TubeControllers;
+template<template<uint8_t, EOrder> class CHIPSET, EOrder ORDER, uint8_t LEDS>
+struct TubeControllers<CHIPSET, ORDER, LEDS> {
+  static void add(CRGB* leds) {}
+};
+template<template<uint8_t, EOrder> class CHIPSET, EOrder ORDER, uint8_t LEDS, uint8_t PIN, uint8_t... PINS>
+struct TubeControllers<CHIPSET, ORDER, LEDS, PIN, PINS...> {
+  static void add(CRGB* leds) {
+    FastLED.addLeds<CHIPSET, PIN, ORDER>(leds, LEDS);
+    TubeControllers<CHIPSET, ORDER, LEDS, PINS...>::add(leds);
+  }
+};
+
+// Display list and change tracking shared by both wirings
+template<uint8_t TUBE_COUNT, uint8_t LEDS, const uint8_t* DIGIT_MAP>
+class TubeList {
+  public:
+    static constexpr uint8_t TUBES = TUBE_COUNT;
+    static constexpr uint8_t LEDS_PER_TUBE = LEDS;
+    static_assert(TUBE_COUNT > 0 && TUBE_COUNT <= 8, "Changes are tracked in one byte, 1 to 8 tubes");
+
+    TubeList() {
+      clear();
+      for(uint8_t i=0;i<TUBES;i++) {
+        _shown[i].digit = TUBE_BLANK;
+        _level[i] = 255;
+      }
+    }
+
+    //Lights one digit of a tube in the next frame, colour is an index into the table given to show()
+    void set(uint8_t tube, uint8_t digit, uint8_t colour) {
+      if(tube >= TUBES)
+        return;
+      _next[tube].digit = digit;
+      _next[tube].colour = colour;
+    }
+
+    //Blanks every tube in the next frame
+    void clear() {
+      for(uint8_t i=0;i<TUBES;i++)
+        _next[i].digit = TUBE_BLANK;
+    }
+
+    //Pushes every tube on the next show(), for when something else has been sending on the data pins
+    void refresh() {
+      _refresh = true;
+    }
+
+    //Fades a tube from its old digit to its new one over ms, 0 switches straight over
+    void setCrossfade(uint16_t ms) {
+      _crossfade = ms;
+    }
+
+    //Switches straight to the next frame without fading, for when the whole display changes
+    void snap() {
+      _snap = true;
+    }
+
+  protected:
+    struct Entry {
+      uint8_t digit;            // TUBE_BLANK if nothing is lit
+      uint8_t colour;           // Index into the colour table
+    };
+
+    Entry _next[TUBE_COUNT];    // Frame being built
+    Entry _shown[TUBE_COUNT];   // Frame last pushed
+    Entry _from[TUBE_COUNT];    // Digit each fading tube is leaving
+    uint16_t _fadeStart[TUBE_COUNT]; // Low 16 bits of millis() when the fade started
+    uint8_t _level[TUBE_COUNT]; // How far each tube is through its fade, 255 when done
+    uint8_t _fading = 0;        // Bit per tube still fading
+    uint16_t _crossfade = 0;    // ms a fade takes, 0 for none
+    uint8_t _brightness = 0;    // Brightness last pushed at
+    bool _refresh = false;      // Push every tube next time
+    bool _snap = false;         // Don't fade into the next frame
+    uint8_t _first = 0;         // Index of the first controller in FastLED
+
+    //Moves the next frame to shown, returns a bit per tube that has to be pushed. A tube changes when its digit does,
+    //when its colour has a bit in changedColours (colours 0 to 7) or when it moves to a colour with a different
+    //value, and on every call while it is fading. A new brightness changes them all
+    uint8_t update(uint8_t brightness, const CRGB* colours, uint8_t changedColours) {
+      bool all = _refresh || brightness != _brightness;
+      _brightness = brightness;
+      _refresh = false;
+      if(_snap)
+        _fading = 0;
+      uint16_t time = millis();
+      uint8_t changed = 0;
+      for(uint8_t i=0;i<TUBES;i++) {
+        const Entry &next = _next[i];
+        Entry &shown = _shown[i];
+        bool same = next.digit == shown.digit;
+        if(same && next.digit != TUBE_BLANK) { //Unflagged, the shown colour still holds the value that was pushed
+          same = !(changedColours & bit(shown.colour)) &&
+                 (next.colour == shown.colour || colours[next.colour] == colours[shown.colour]);
+        } else if(!same && _crossfade && !_snap) {
+          _from[i] = shown;
+          _fadeStart[i] = time;
+          _fading |= bit(i);
+        }
+        shown = next;
+        if(_fading & bit(i)) {
+          uint16_t elapsed = time - _fadeStart[i];
+          if(elapsed >= _crossfade) {
+            _level[i] = 255;
+            _fading &= ~bit(i);
+          } else {
+            _level[i] = ((uint32_t)elapsed << 8) / _crossfade;
+          }
+        } else if(!all && same) {
+          continue;
+        } else {
+          _level[i] = 255;
+        }
+        changed |= bit(i);
+      }
+      _snap = false;
+      return changed;
+    }
+
+    //LED behind a digit
+    uint8_t led(uint8_t digit) {
+      return DIGIT_MAP != nullptr ? pgm_read_byte(DIGIT_MAP + digit) : digit;
+    }
+
+    //Splits a colour between two LEDs, level/256 of it to one and the rest to the other
+    static void split(const CRGB& colour, uint8_t level, CRGB& part, CRGB& rest) {
+      for(uint8_t c=0;c<3;c++) {
+        part.raw[c] = scale8(colour.raw[c], level);
+        rest.raw[c] = colour.raw[c] - part.raw[c];
+      }
+    }
+
+    //Fills one tube's LEDs from the shown frame, part way between the old and new digit if it is fading
+    void expand(uint8_t tube, CRGB* leds, const CRGB* colours) {
+      fill_solid(leds, LEDS, CRGB::Black);
+      const Entry &shown = _shown[tube];
+      const Entry &from = _from[tube];
+      uint8_t level = _level[tube];
+      if(level == 255) {
+        if(shown.digit != TUBE_BLANK)
+          leds[led(shown.digit)] = colours[shown.colour];
+        return;
+      }
+      CRGB part, rest;
+      if(from.digit != TUBE_BLANK) {
+        split(colours[from.colour], level, part, rest);
+        leds[led(from.digit)] = rest;
+      }
+      if(shown.digit != TUBE_BLANK) {
+        split(colours[shown.colour], level, part, rest);
+        leds[led(shown.digit)] = part;
+      }
+    }
+};
+
+// One data pin per tube, only the tubes that changed are pushed
+template<template<uint8_t, EOrder> class CHIPSET, EOrder ORDER, uint8_t LEDS, const uint8_t* DIGIT_MAP, uint8_t... PINS>
+class TubeStrips : public TubeList<sizeof...(PINS), LEDS, DIGIT_MAP> {
+  public:
+    void begin() {
+      this->_first = FastLED.count();
+      TubeControllers<CHIPSET, ORDER, LEDS, PINS...>::add(_leds);
+    }
+
+    //Pushes the changed tubes at a brightness, returns true if any were pushed
+    bool show(uint8_t brightness, const CRGB* colours, uint8_t changedColours = TUBE_ALL_COLOURS) {
+      uint8_t changed = this->update(brightness, colours, changedColours);
+      for(uint8_t i=0;i<sizeof...(PINS);i++) {
+        if(!(changed & bit(i)))
+          continue;
+        this->expand(i, _leds, colours);
+        FastLED[this->_first + i].showLeds(brightness);
+      }
+      return changed != 0;
+    }
+
+  private:
+    CRGB _leds[LEDS];           // One tube, refilled for each push
+};
+
+// Every tube daisy chained on one data pin, the whole chain is pushed once if any tube changed
+template<template<uint8_t, EOrder> class CHIPSET, EOrder ORDER, uint8_t LEDS, const uint8_t* DIGIT_MAP, uint8_t TUBE_COUNT,
+         uint8_t PIN>
+class TubeChain : public TubeList<TUBE_COUNT, LEDS, DIGIT_MAP> {
+  public:
+    void begin() {
+      this->_first = FastLED.count();
+      FastLED.addLeds<CHIPSET, PIN, ORDER>(_leds[0], TUBE_COUNT * LEDS);
+    }
+
+    //Pushes the chain at a brightness if any tube changed, returns true if it was pushed
+    bool show(uint8_t brightness, const CRGB* colours, uint8_t changedColours = TUBE_ALL_COLOURS) {
+      uint8_t changed = this->update(brightness, colours, changedColours);
+      if(!changed)
+        return false;
+      for(uint8_t i=0;i<TUBE_COUNT;i++) {
+        if(changed & bit(i))
+          this->expand(i, _leds[i], colours);
+      }
+      FastLED[this->_first].showLeds(brightness);
+      return true;
+    }
+
+  private:
+    CRGB _leds[TUBE_COUNT][LEDS];
+};
+
+#endif
@@ -0,0 +1,390 @@
+/*
+ * Nixie Clock Project
+ * Virtual ATmega328 for the host build, see Board.h
+ */
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include "Devices.h"
+
+Board board;
+HardwareSerial Serial;
+
+volatile unsigned long timer0_millis = 0;
+volatile uint8_t SREG, PINB, PINC, PIND, PCICR, PCMSK0, PCMSK1, PCMSK2, EIMSK;
+volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0, ADCH;
+uint8_t sleepMode = SLEEP_MODE_IDLE;
+bool sleepEnabled = false;
+
+// CPU time each interrupt's handler takes, us
+static const uint8_t isrTime[IRQ_COUNT] = { 3, 3, 8, 8, 8, 5, 6 };
+
+Board::Board() {
+  reset();
+}
+
+void Board::reset() {
+  _time = 0;
+  _timerTime = 0;
+  _nextAdc = 0;
+  _state = CPU_ACTIVE;
+  _pending = 0;
+  _inIsr = false;
+  _woke = false;
+  _serialOpen = false;
+  for(uint8_t i=0;i<BOARD_PINS;i++) {
+    _external[i] = false;
+    _pullup[i] = false;
+    _output[i] = false;
+    _outputLevel[i] = false;
+    _level[i] = false;
+  }
+  _isr[0] = _isr[1] = nullptr;
+  _isrMode[0] = _isrMode[1] = 0;
+  _script.clear();
+  timer0_millis = 0;
+  SREG = 0x80;                                     // The core enables interrupts before setup()
+  PINB = PINC = PIND = PCICR = PCMSK0 = PCMSK1 = PCMSK2 = EIMSK = 0;
+  ADMUX = ADCSRA = ADCSRB = DIDR0 = ADCH = 0;
+  sleepMode = SLEEP_MODE_IDLE;
+  sleepEnabled = false;
+  serialOut.clear();
+  serialClosed = 0;
+  audio = nullptr;
+  mfpPin = 2;
+  for(uint8_t i=0;i<CPU_STATES;i++)
+    cpuTime[i] = 0;
+  for(uint8_t i=0;i<IRQ_COUNT;i++)
+    irqCount[i] = 0;
+  adcTime = 0;
+  wakeups = 0;
+}
+
+void Board::spend(unsigned long us) {
+  advance(_time + us);
+}
+
+void Board::spendBlocked(unsigned long us) {
+  uint8_t sreg = SREG;
+  SREG &= ~0x80;
+  advance(_time + us);
+  SREG = sreg;
+  deliver();
+}
+
+void Board::sleep(uint8_t mode) {
+  if(!sleepEnabled)
+    return;
+  if(!interruptsEnabled()) {
+    fprintf(stderr, "board: sleeping with interrupts off at %lu us, nothing can wake it\n", _time);
+    exit(2);
+  }
+  _state = mode == SLEEP_MODE_PWR_DOWN ? CPU_POWER_DOWN : CPU_IDLE;
+  _woke = false;
+  while(!_woke)
+    step(~0UL);
+  _state = CPU_ACTIVE;
+}
+
+void Board::powerDown(unsigned long us) {
+  uint8_t state = _state;
+  _state = CPU_POWER_DOWN;
+  advance(_time + us);
+  _state = state;
+}
+
+void Board::run(void (*loop)(), unsigned long ms, unsigned long passTime) {
+  unsigned long until = _time + ms * 1000;
+  while(_time < until) {
+    unsigned long start = _time;
+    loop();
+    if(_time - start < passTime)
+      spend(passTime - (_time - start));
+  }
+}
+
+void Board::pinMode(uint8_t pin, uint8_t mode) {
+  if(pin >= BOARD_PINS)
+    return;
+  _output[pin] = mode == OUTPUT;
+  _pullup[pin] = mode == INPUT_PULLUP;
+  updatePin(pin);
+}
+
+bool Board::read(uint8_t pin) const {
+  return pin < BOARD_PINS && _level[pin];
+}
+
+void Board::write(uint8_t pin, uint8_t level) {
+  if(pin >= BOARD_PINS)
+    return;
+  if(_output[pin])
+    _outputLevel[pin] = level;
+  else
+    _pullup[pin] = level;                          // Writing an input turns its pull-up on or off
+  updatePin(pin);
+}
+
+void Board::drive(uint8_t pin, bool level) {
+  if(pin >= BOARD_PINS)
+    return;
+  _external[pin] = level;
+  updatePin(pin);
+}
+
+void Board::at(unsigned long ms, uint8_t pin, bool level) {
+  Script change = { ms * 1000, pin, level };
+  auto i = _script.begin();
+  while(i != _script.end() && i->time <= change.time)
+    ++i;
+  _script.insert(i, change);
+}
+
+void Board::press(unsigned long ms, uint8_t pin, unsigned long held) {
+  at(ms, pin, true);
+  at(ms + held, pin, false);
+}
+
+void Board::attach(uint8_t n, void (*isr)(), int mode) {
+  if(n > 1)
+    return;
+  _isr[n] = isr;
+  _isrMode[n] = mode;
+  EIMSK |= bit(n);
+}
+
+void Board::detach(uint8_t n) {
+  if(n > 1)
+    return;
+  EIMSK &= ~bit(n);
+  _isr[n] = nullptr;
+}
+
+void Board::enableInterrupts() {
+  SREG |= 0x80;
+  deliver();
+}
+
+void Board::disableInterrupts() {
+  SREG &= ~0x80;
+}
+
+bool Board::interruptsEnabled() const {
+  return SREG & 0x80;
+}
+
+void Board::serialOpen(bool open) {
+  _serialOpen = open;
+}
+
+size_t Board::serialWrite(const uint8_t* data, size_t len) {
+  if(_serialOpen)
+    serialOut.append((const char*)data, len);
+  else
+    serialClosed += len;
+  if(serialEcho)
+    fwrite(data, 1, len, stdout);
+  return len;
+}
+
+double Board::averageCurrent() const {
+  unsigned long total = cpuTime[CPU_ACTIVE] + cpuTime[CPU_IDLE] + cpuTime[CPU_POWER_DOWN];
+  if(total == 0)
+    return 0;
+  double charge = cpuTime[CPU_ACTIVE] * CURRENT_ACTIVE + cpuTime[CPU_IDLE] * CURRENT_IDLE +
+                  cpuTime[CPU_POWER_DOWN] * CURRENT_POWER_DOWN + adcTime * CURRENT_ADC;
+  return charge / total;
+}
+
+void Board::report(FILE* out) const {
+  static const char* const names[IRQ_COUNT] = { "INT0", "INT1", "PCINT0", "PCINT1", "PCINT2", "TIMER0", "ADC" };
+  double seconds = _time / 1e6;
+  fprintf(out, "time %.1fs: active %.3fs idle %.3fs power-down %.3fs, ADC on %.3fs\n", seconds,
+          cpuTime[CPU_ACTIVE] / 1e6, cpuTime[CPU_IDLE] / 1e6, cpuTime[CPU_POWER_DOWN] / 1e6, adcTime / 1e6);
+  fprintf(out, "interrupts per s:");
+  for(uint8_t i=0;i<IRQ_COUNT;i++)
+    fprintf(out, " %s %.1f", names[i], seconds > 0 ? irqCount[i] / seconds : 0);
+  fprintf(out, ", wake-ups per s %.1f\n", seconds > 0 ? wakeups / seconds : 0);
+  fprintf(out, "average MCU current %.2fmA, %.1fmAh a day\n", averageCurrent(), averageCurrent() * 24);
+}
+
+//Moves the clock on to until, delivering everything that happens on the way
+void Board::advance(unsigned long until) {
+  while(_time < until)
+    step(until);
+}
+
+//Moves the clock to the next event or until, whichever comes first, and handles the events due then
+void Board::step(unsigned long until) {
+  deliver();
+  unsigned long next = until;
+  if(_state != CPU_POWER_DOWN) {
+    unsigned long tick = _time + TIMER0_PERIOD - _timerTime % TIMER0_PERIOD;
+    if(tick < next)
+      next = tick;
+  }
+  if(adcRunning()) {
+    if(_nextAdc == 0)
+      _nextAdc = _time + ADC_PERIOD;
+    if(_nextAdc < next)
+      next = _nextAdc;
+  } else {
+    _nextAdc = 0;
+  }
+  unsigned long rtc = rtcModel.nextEvent(_time);
+  if(rtc < next)
+    next = rtc;
+  if(!_script.empty() && _script.front().time < next)
+    next = _script.front().time;
+  if(next == ~0UL) {
+    fprintf(stderr, "board: asleep at %lu us with nothing left to wake it\n", _time);
+    exit(2);
+  }
+  if(next < _time)
+    next = _time;
+
+  unsigned long elapsed = next - _time;
+  cpuTime[_state] += elapsed;
+  if(ADCSRA & bit(ADEN) && _state != CPU_POWER_DOWN)
+    adcTime += elapsed;
+  unsigned long ticks = 0;
+  if(_state != CPU_POWER_DOWN) {
+    ticks = (_timerTime + elapsed) / TIMER0_PERIOD - _timerTime / TIMER0_PERIOD;
+    _timerTime += elapsed;
+  }
+  _time = next;
+  for(unsigned long i=0;i<ticks;i++)
+    raise(IRQ_TIMER0);
+  events();
+}
+
+//Everything due at the current time apart from Timer0, which step() raises
+void Board::events() {
+  if(_nextAdc != 0 && _time >= _nextAdc) {
+    _nextAdc += ADC_PERIOD;
+    ADCH = audio ? audio(_time) : 128;
+    if(ADCSRA & bit(ADIE))
+      raise(IRQ_ADC);
+  }
+  rtcModel.run(_time);
+  if(mfpPin < BOARD_PINS)
+    drive(mfpPin, rtcModel.mfp());
+  while(!_script.empty() && _script.front().time <= _time) {
+    Script change = _script.front();
+    _script.erase(_script.begin());
+    drive(change.pin, change.level);
+  }
+}
+
+//Works out what a pin reads and raises its interrupts if that changed
+void Board::updatePin(uint8_t pin) {
+  bool level;
+  if(_output[pin])
+    level = _outputLevel[pin];
+  else if(pin == mfpPin)
+    level = _external[pin] && _pullup[pin];        // Open drain, high only through the pull-up
+  else
+    level = _external[pin] || _pullup[pin];
+  if(level == _level[pin])
+    return;
+  _level[pin] = level;
+
+  volatile uint8_t* port;
+  uint8_t group, index;
+  if(pin < 8) {
+    port = &PIND;
+    group = 2;
+    index = pin;
+  } else if(pin < 14) {
+    port = &PINB;
+    group = 0;
+    index = pin - 8;
+  } else {
+    port = &PINC;
+    group = 1;
+    index = pin - 14;
+  }
+  if(level)
+    *port |= bit(index);
+  else
+    *port &= ~bit(index);
+
+  if((pin == 2 || pin == 3) && _state != CPU_POWER_DOWN) {
+    uint8_t n = pin - 2;
+    uint8_t mode = _isrMode[n];
+    if((EIMSK & bit(n)) && (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)))
+      raise(IRQ_INT0 + n);
+  }
+  volatile uint8_t* mask = group == 0 ? &PCMSK0 : (group == 1 ? &PCMSK1 : &PCMSK2);
+  if((PCICR & bit(group)) && (*mask & bit(index)))
+    raise(IRQ_PCINT0 + group);
+}
+
+void Board::raise(uint8_t irq) {
+  if(_state == CPU_POWER_DOWN && irq != IRQ_PCINT0 && irq != IRQ_PCINT1 && irq != IRQ_PCINT2)
+    return;                                        // Only asynchronous sources run without the clock
+  _pending |= bit(irq);
+  deliver();
+}
+
+//Runs the held interrupts, lowest vector first, if interrupts are enabled
+void Board::deliver() {
+  while(_pending && interruptsEnabled() && !_inIsr) {
+    uint8_t irq = 0;
+    while(!(_pending & bit(irq)))
+      irq++;
+    _pending &= ~bit(irq);
+    if(_state == CPU_POWER_DOWN) {
+      cpuTime[CPU_IDLE] += WAKE_TIME;              // Oscillator start-up, the clock is stopped until it is done
+      _time += WAKE_TIME;
+    }
+    if(_state != CPU_ACTIVE) {
+      _woke = true;
+      wakeups++;
+      unsigned long moved = min((unsigned long)isrTime[irq], cpuTime[_state]);
+      cpuTime[_state] -= moved;
+      cpuTime[CPU_ACTIVE] += moved;
+      _state = CPU_IDLE;                           // Runs with the clock on until sleep() returns
+    }
+    irqCount[irq]++;
+    _inIsr = true;
+    SREG &= ~0x80;
+    handle(irq);
+    SREG |= 0x80;
+    _inIsr = false;
+  }
+}
+
+void Board::handle(uint8_t irq) {
+  switch(irq) {
+    case IRQ_INT0:
+    case IRQ_INT1:
+      if(_isr[irq])
+        _isr[irq]();
+      break;
+    case IRQ_PCINT0:
+      if(PCINT0_vect)
+        PCINT0_vect();
+      break;
+    case IRQ_PCINT1:
+      if(PCINT1_vect)
+        PCINT1_vect();
+      break;
+    case IRQ_PCINT2:
+      if(PCINT2_vect)
+        PCINT2_vect();
+      break;
+    case IRQ_TIMER0:
+      timer0_millis++;
+      break;
+    case IRQ_ADC:
+      if(ADC_vect)
+        ADC_vect();
+      break;
+  }
+}
+
+bool Board::adcRunning() const {
+  uint8_t running = bit(ADEN) | bit(ADSC) | bit(ADATE);
+  return (ADCSRA & running) == running && _state != CPU_POWER_DOWN;
+}
@@ -0,0 +1,173 @@
+/*
+ * Nixie Clock Project
+ * Virtual ATmega328 for the host build
+ *
+ * Keeps the time, the pins and the interrupts the sketches see through the Arduino stubs. Nothing happens on its own:
+ * time moves when the sketch spends it (an I2C transfer, a tube push, delay(), a pass of loop()) or sleeps, and the
+ * board delivers the interrupts that fall inside that time in order. Timer0 overflows every millisecond while the
+ * CPU clock runs, the ADC converts every 104us while it free-runs, the MCP7940 model drives the MFP pin and scripted
+ * pin changes press buttons. An interrupt that comes while interrupts are disabled is held, one per vector, until
+ * they are enabled again, as on the chip, and a Timer0 overflow held too long is lost along with its millisecond.
+ *
+ * Pins are modelled at the level the sketches use them: an external level per pin, the internal pull-up, and the
+ * PINx, PCMSKx, PCICR and EIMSK registers. INT0/INT1 edges need the I/O clock, so they are not seen in power-down,
+ * pin changes are.
+ *
+ * The board also keeps an energy account: how long the CPU was running, idle or powered down, how often each
+ * interrupt ran, and from that an estimate of the average supply current of the ATmega328 alone, using typical
+ * datasheet figures at 5V and 16MHz.
+ */
+
+#ifndef Board_h
+#define Board_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define BOARD_PINS        20    // D0-D13 and A0-A5
+
+// Interrupt sources, in vector order, which is also the order held interrupts are delivered in
+#define IRQ_INT0          0
+#define IRQ_INT1          1
+#define IRQ_PCINT0        2
+#define IRQ_PCINT1        3
+#define IRQ_PCINT2        4
+#define IRQ_TIMER0        5
+#define IRQ_ADC           6
+#define IRQ_COUNT         7
+
+// CPU states for the energy account
+#define CPU_ACTIVE        0
+#define CPU_IDLE          1
+#define CPU_POWER_DOWN    2
+#define CPU_STATES        3
+
+#define TIMER0_PERIOD     1000  // us between Timer0 overflows, the millis() tick
+#define ADC_PERIOD        104   // us per conversion, 13 ADC clocks at 16MHz / 128
+#define WAKE_TIME         1000  // us from a power-down wake up to the first instruction, 16K CK start-up
+
+// Typical ATmega328 supply current at 5V and 16MHz, mA
+#define CURRENT_ACTIVE    9.0
+#define CURRENT_IDLE      2.5
+#define CURRENT_POWER_DOWN 0.02 // Brown-out detector on, watchdog off
+#define CURRENT_ADC       0.25  // Extra while the ADC is enabled, any state but power-down
+
+// Interrupt and ADC registers the sketches write directly
+extern volatile uint8_t SREG, PINB, PINC, PIND, PCICR, PCMSK0, PCMSK1, PCMSK2, EIMSK;
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0, ADCH;
+
+#define PCIE0             0
+#define PCIE1             1
+#define PCIE2             2
+#define INT0              0
+#define INT1              1
+#define REFS0             6
+#define ADLAR             5
+#define ADEN              7
+#define ADSC              6
+#define ADATE             5
+#define ADIF              4
+#define ADIE              3
+#define ADPS2             2
+#define ADPS1             1
+#define ADPS0             0
+
+// Vectors the sketches may define with ISR(), weak so a sketch that doesn't is still linked
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+extern "C" void ADC_vect(void) __attribute__((weak));
+
+typedef uint8_t (*AudioSource)(unsigned long time);   // ADCH for a conversion at a board time in us
+
+class Board {
+  public:
+    Board();
+
+    //Back to power on: time 0, pins low, registers clear, nothing attached or scripted
+    void reset();
+
+    // Time
+    unsigned long time() const { return _time; }    // us since reset, wall clock
+    unsigned long micros() const { return _timerTime; } // us Timer0 has counted
+    void spend(unsigned long us);                   // CPU busy for us, interrupts delivered as they come
+    void spendBlocked(unsigned long us);            // CPU busy for us with interrupts off, e.g. an LED push
+    void sleep(uint8_t mode);                       // sleep_cpu(), returns once an interrupt has woken the CPU
+    void powerDown(unsigned long us);               // Powered down for us whatever wakes it, only the RTC and
+                                                    // scripted pins move, for letting days pass quickly
+    void run(void (*loop)(), unsigned long ms, unsigned long passTime = 10); // Calls loop() for ms, each pass
+                                                    // costing at least passTime us
+
+    // Pins
+    void pinMode(uint8_t pin, uint8_t mode);
+    bool read(uint8_t pin) const;
+    void write(uint8_t pin, uint8_t level);
+    void drive(uint8_t pin, bool level);            // Level something outside the chip puts on the pin
+    void at(unsigned long ms, uint8_t pin, bool level); // Scripted drive() at a board time
+    void press(unsigned long ms, uint8_t pin, unsigned long held); // Scripted button press, active high
+
+    // Interrupts
+    void attach(uint8_t n, void (*isr)(), int mode);
+    void detach(uint8_t n);
+    void enableInterrupts();
+    void disableInterrupts();
+    bool interruptsEnabled() const;
+
+    // Serial, bytes sent while it is open are kept, everything can be echoed to stdout
+    void serialOpen(bool open);
+    size_t serialWrite(const uint8_t* data, size_t len);
+    bool serialEcho = false;
+    std::string serialOut;                          // Sent while open
+    unsigned long serialClosed = 0;                 // Bytes printed while the port was closed
+
+    AudioSource audio = nullptr;                    // Audio on the ADC pin, mid-rail silence if not set
+    uint8_t mfpPin = 2;                             // Where the RTC's MFP output is wired, 0xFF for nowhere
+
+    // Energy account
+    unsigned long cpuTime[CPU_STATES];              // us spent in each state
+    unsigned long adcTime = 0;                      // us the ADC was enabled
+    unsigned long irqCount[IRQ_COUNT];              // Interrupts delivered from each source
+    unsigned long wakeups = 0;                      // Interrupts that ended a sleep
+    double averageCurrent() const;                  // mA over the whole run
+    void report(FILE* out) const;
+
+  private:
+    struct Script {
+      unsigned long time;                           // us
+      uint8_t pin;
+      bool level;
+    };
+
+    unsigned long _time = 0;
+    unsigned long _timerTime = 0;                   // Timer0 counts only while the CPU clock runs
+    unsigned long _nextAdc = 0;                     // 0 while the ADC isn't running
+    uint8_t _state = CPU_ACTIVE;
+    uint8_t _pending = 0;                           // Bit per IRQ_ source held for delivery
+    bool _inIsr = false;
+    bool _woke = false;
+    bool _serialOpen = false;
+
+    bool _external[BOARD_PINS];                     // Level driven from outside
+    bool _pullup[BOARD_PINS];
+    bool _output[BOARD_PINS];
+    bool _outputLevel[BOARD_PINS];
+    bool _level[BOARD_PINS];                        // What the pin reads
+    void (*_isr[2])();
+    uint8_t _isrMode[2];
+    std::vector<Script> _script;                    // Sorted by time
+
+    void advance(unsigned long until);
+    void step(unsigned long until);
+    void events();
+    void updatePin(uint8_t pin);
+    void raise(uint8_t irq);
+    void deliver();
+    void handle(uint8_t irq);
+    bool adcRunning() const;
+};
+
+extern Board board;
+
+#endif
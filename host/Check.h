@@ -0,0 +1,34 @@
+/*
+ * Nixie Clock Project
+ * Checks for the host tests: CHECK() prints each failure with its line and the test exits with the failure count
+ */
+
+#ifndef Check_h
+#define Check_h
+
+#include <stdio.h>
+
+static unsigned checkFailures = 0;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+      checkFailures++; \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+    } \
+  } while(0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+    long long e_ = (long long)(expected), a_ = (long long)(actual); \
+    if(e_ != a_) { \
+      checkFailures++; \
+      printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+    } \
+  } while(0)
+
+//Result line and exit status for main()
+static int checkResult(const char* test) {
+  printf("%s: %s\n", test, checkFailures ? "FAILED" : "passed");
+  return checkFailures ? 1 : 0;
+}
+
+#endif
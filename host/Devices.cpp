@@ -0,0 +1,408 @@
+/*
+ * Nixie Clock Project
+ * MCP7940 and Si7006 models on the host build's I2C bus, see Devices.h
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Devices.h"
+
+TwoWire Wire;
+Mcp7940Model rtcModel;
+Si7006Model sensorModel;
+
+// MCP7940 registers the model gives a meaning to
+#define RTCSEC            0x00
+#define RTCWKDAY          0x03
+#define RTCMTH            0x05
+#define RTCYEAR           0x06
+#define CONTROL           0x07
+#define OSCTRIM           0x08
+#define ALM0SEC           0x0A
+#define ALM0WKDAY         0x0D
+#define ALM1WKDAY         0x14
+#define PWRDNMIN          0x18
+#define SRAM_START        0x20
+
+#define ST                0x80  // RTCSEC
+#define OSCRUN            0x20  // RTCWKDAY
+#define PWRFAIL           0x10  // RTCWKDAY
+#define LPYR              0x20  // RTCMTH
+#define OUT               0x80  // CONTROL
+#define SQWEN             0x40  // CONTROL
+#define ALM1EN            0x20  // CONTROL
+#define ALM0EN            0x10  // CONTROL
+#define ALMPOL            0x80  // ALM0WKDAY
+#define ALMIF             0x08  // ALMxWKDAY
+
+#define SECOND_US         1000000.0
+#define PHASE_SLACK       0.001 // us, rounding allowed when a step lands on a second or half second
+
+static uint8_t fromBCD(uint8_t bcd) {
+  return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+static uint8_t toBCD(uint8_t value) {
+  return (value / 10) << 4 | value % 10;
+}
+
+static bool leapYear(uint8_t year) {
+  return year % 4 == 0;                            // 2000 to 2099
+}
+
+static uint8_t monthDays(uint8_t month, uint8_t year) {
+  static const uint8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  if(month < 1 || month > 12)
+    return 31;
+  return month == 2 && leapYear(year) ? 29 : days[month - 1];
+}
+
+/*******************************************************************************************************************
+** Wire                                                                                                           **
+*******************************************************************************************************************/
+
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+  transactions++;
+  uint8_t status = 2;                              // Address NACK, nobody there
+  if(_address == MCP7940_MODEL_ADDRESS)
+    status = rtcModel.write(_tx, _txLength);
+  else if(_address == SI7006_MODEL_ADDRESS)
+    status = sensorModel.write(_tx, _txLength);
+  transfer(status == 2 ? 1 : _txLength + 1);
+  _txLength = 0;
+  return status;
+}
+
+uint8_t TwoWire::request(uint8_t address, uint8_t quantity) {
+  transactions++;
+  if(quantity > BUFFER_LENGTH)
+    quantity = BUFFER_LENGTH;
+  uint8_t got = 0;
+  if(address == MCP7940_MODEL_ADDRESS)
+    got = rtcModel.read(_rx, quantity);
+  else if(address == SI7006_MODEL_ADDRESS)
+    got = sensorModel.read(_rx, quantity);
+  transfer(got + 1);
+  _rxLength = got;
+  _rxIndex = 0;
+  return got;
+}
+
+//Charges the board for a transaction, 9 bit times a byte plus start and stop
+void TwoWire::transfer(uint8_t bytes) {
+  board.spend(((unsigned long)bytes * 9 + 2) * 1000000UL / _clock);
+}
+
+/*******************************************************************************************************************
+** MCP7940                                                                                                        **
+*******************************************************************************************************************/
+
+void Mcp7940Model::reset() {
+  memset(reg, 0, sizeof(reg));
+  _pointer = 0;
+  _phase = 0;
+  _last = board.time();
+  _startAt = 0;
+  transactions = 0;
+  writes = 0;
+  timeReads = 0;
+}
+
+void Mcp7940Model::setTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute,
+                           uint8_t second, uint8_t weekday) {
+  uint8_t y = year - 2000;
+  reg[RTCSEC] = ST | toBCD(second);
+  reg[RTCSEC + 1] = toBCD(minute);
+  reg[RTCSEC + 2] = toBCD(hour);
+  reg[RTCWKDAY] = (reg[RTCWKDAY] & 0x18) | OSCRUN | weekday;
+  reg[RTCWKDAY + 1] = toBCD(day);
+  reg[RTCMTH] = toBCD(month) | (leapYear(y) ? LPYR : 0);
+  reg[RTCYEAR] = toBCD(y);
+  _phase = 0;
+  _startAt = 0;
+  _last = board.time();
+}
+
+uint32_t Mcp7940Model::seconds() const {
+  uint8_t year = field(RTCYEAR);
+  uint32_t days = field(RTCWKDAY + 1) - 1;
+  for(uint8_t m=1;m<field(RTCMTH);m++)
+    days += monthDays(m, year);
+  days += year * 365UL + (year + 3) / 4;
+  return ((days * 24 + field(RTCSEC + 2)) * 60 + field(RTCSEC + 1)) * 60 + field(RTCSEC);
+}
+
+uint8_t Mcp7940Model::field(uint8_t addr) const {
+  static const uint8_t masks[7] = { 0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF };
+  return fromBCD(reg[addr] & (addr < 7 ? masks[addr] : 0xFF));
+}
+
+bool Mcp7940Model::oscillatorRunning() const {
+  return reg[RTCWKDAY] & OSCRUN;
+}
+
+bool Mcp7940Model::mfp() const {
+  if(!present)
+    return true;                                   // Off the board, the pull-up holds the pin high
+  uint8_t control = reg[CONTROL];
+  if(control & SQWEN) {
+    if((control & 0x03) != 0 || !oscillatorRunning())
+      return true;                                 // Only the 1Hz output is slow enough to model
+    return _phase >= SECOND_US / 2 - PHASE_SLACK;  // Low for the first half of each second
+  }
+  bool enabled0 = control & ALM0EN;
+  bool enabled1 = control & ALM1EN;
+  if(enabled0 || enabled1) {
+    bool flag0 = enabled0 && (reg[ALM0WKDAY] & ALMIF);
+    bool flag1 = enabled1 && (reg[ALM1WKDAY] & ALMIF);
+    if(reg[ALM0WKDAY] & ALMPOL)
+      return flag0 || flag1;
+    if(enabled0 && enabled1)
+      return !(flag0 && flag1);
+    return !(flag0 || flag1);
+  }
+  return control & OUT;
+}
+
+unsigned long Mcp7940Model::nextEvent(unsigned long now) const {
+  unsigned long next = ~0UL;
+  if(_startAt)
+    next = _startAt;
+  if(oscillatorRunning()) {
+    double boundary = _phase < SECOND_US / 2 - PHASE_SLACK ? SECOND_US / 2 : SECOND_US;
+    unsigned long wait = (unsigned long)ceil((boundary - _phase) / rate());
+    unsigned long at = _last + (wait ? wait : 1);
+    if(at < next)
+      next = at;
+  }
+  return next < now ? now : next;
+}
+
+void Mcp7940Model::run(unsigned long now) {
+  if(now <= _last)
+    return;
+  unsigned long elapsed = now - _last;
+  _last = now;
+  if(_startAt && now >= _startAt) {
+    elapsed = now - _startAt;
+    _startAt = 0;
+    _phase = 0;
+    reg[RTCWKDAY] |= OSCRUN;
+  }
+  if(!oscillatorRunning())
+    return;
+  _phase += elapsed * rate();
+  while(_phase >= SECOND_US - PHASE_SLACK) {
+    _phase = _phase > SECOND_US ? _phase - SECOND_US : 0;
+    increment();
+  }
+}
+
+uint8_t Mcp7940Model::write(const uint8_t* data, uint8_t len) {
+  if(!present)
+    return 2;
+  run(board.time());
+  transactions++;
+  if(len == 0)
+    return 0;                                      // Just checking it is there
+  _pointer = data[0];
+  for(uint8_t i=1;i<len;i++) {
+    store(_pointer, data[i]);
+    _pointer = _pointer < SRAM_START ? (_pointer + 1) & 0x1F : (_pointer + 1 >= MCP7940_MODEL_SIZE ? SRAM_START : _pointer + 1);
+  }
+  if(len > 1)
+    writes++;
+  return 0;
+}
+
+uint8_t Mcp7940Model::read(uint8_t* data, uint8_t len) {
+  if(!present)
+    return 0;
+  run(board.time());
+  transactions++;
+  if(_pointer == RTCSEC && len >= 7)
+    timeReads++;
+  for(uint8_t i=0;i<len;i++) {
+    data[i] = load(_pointer);
+    _pointer = _pointer < SRAM_START ? (_pointer + 1) & 0x1F : (_pointer + 1 >= MCP7940_MODEL_SIZE ? SRAM_START : _pointer + 1);
+  }
+  return len;
+}
+
+//Ticks per real second, the crystal error plus 2 clocks a minute for each OSCTRIM step
+double Mcp7940Model::rate() const {
+  uint8_t trim = reg[OSCTRIM];
+  double steps = (trim & 0x7F) * (trim & 0x80 ? 1 : -1);  // Sign set adds clocks
+  return 1 + ppm * 1e-6 + steps * 2 / (32768.0 * 60);
+}
+
+void Mcp7940Model::store(uint8_t addr, uint8_t value) {
+  if(addr >= MCP7940_MODEL_SIZE)
+    return;
+  switch(addr) {
+    case RTCSEC: {
+      bool wasSet = reg[RTCSEC] & ST;
+      reg[RTCSEC] = value;
+      if(!wasSet && (value & ST)) {
+        _startAt = board.time() + startTime;
+        if(_startAt == 0)
+          _startAt = 1;
+      } else if(wasSet && !(value & ST)) {
+        _startAt = 0;
+        _phase = 0;
+        reg[RTCWKDAY] &= ~OSCRUN;
+      }
+      break;
+    }
+    case RTCWKDAY:
+      reg[RTCWKDAY] = (value & ~(OSCRUN | PWRFAIL)) | (reg[RTCWKDAY] & OSCRUN) | (reg[RTCWKDAY] & value & PWRFAIL);
+      break;
+    case RTCMTH:
+      reg[RTCMTH] = (value & ~LPYR) | (reg[RTCMTH] & LPYR);
+      break;
+    case RTCYEAR:
+      reg[RTCYEAR] = value;
+      reg[RTCMTH] = (reg[RTCMTH] & ~LPYR) | (leapYear(fromBCD(value)) ? LPYR : 0);
+      break;
+    case ALM1WKDAY:
+      reg[ALM1WKDAY] = value & ~ALMPOL;            // Read-only copy of the ALM0WKDAY bit
+      break;
+    default:
+      if(addr >= PWRDNMIN && addr < SRAM_START)
+        break;                                     // Power-fail time stamps are read-only
+      reg[addr] = value;
+  }
+}
+
+uint8_t Mcp7940Model::load(uint8_t addr) const {
+  if(addr >= MCP7940_MODEL_SIZE)
+    return 0;
+  if(addr == ALM1WKDAY)
+    return (reg[ALM1WKDAY] & ~ALMPOL) | (reg[ALM0WKDAY] & ALMPOL);
+  return reg[addr];
+}
+
+//One second on in BCD, carrying through to the year
+void Mcp7940Model::increment() {
+  uint8_t second = field(RTCSEC) + 1;
+  reg[RTCSEC] = (reg[RTCSEC] & ST) | toBCD(second % 60);
+  if(second >= 60) {
+    uint8_t minute = field(RTCSEC + 1) + 1;
+    reg[RTCSEC + 1] = toBCD(minute % 60);
+    if(minute >= 60) {
+      uint8_t hour = field(RTCSEC + 2) + 1;
+      reg[RTCSEC + 2] = (reg[RTCSEC + 2] & 0xC0) | toBCD(hour % 24);
+      if(hour >= 24) {
+        uint8_t weekday = reg[RTCWKDAY] & 0x07;
+        reg[RTCWKDAY] = (reg[RTCWKDAY] & ~0x07) | (weekday >= 7 ? 1 : weekday + 1);
+        uint8_t year = field(RTCYEAR);
+        uint8_t month = field(RTCMTH);
+        uint8_t day = field(RTCWKDAY + 1) + 1;
+        if(day > monthDays(month, year)) {
+          day = 1;
+          if(++month > 12) {
+            month = 1;
+            year = (year + 1) % 100;
+            reg[RTCYEAR] = toBCD(year);
+          }
+        }
+        reg[RTCWKDAY + 1] = toBCD(day);
+        reg[RTCMTH] = toBCD(month) | (leapYear(year) ? LPYR : 0);
+      }
+    }
+  }
+  matchAlarms();
+}
+
+//Sets the flag of each enabled alarm whose masked fields match the new time
+void Mcp7940Model::matchAlarms() {
+  for(uint8_t n=0;n<2;n++) {
+    if(!(reg[CONTROL] & (n ? ALM1EN : ALM0EN)))
+      continue;
+    const uint8_t* alarm = reg + ALM0SEC + 7 * n;
+    bool second = (alarm[0] & 0x7F) == (reg[RTCSEC] & 0x7F);
+    bool minute = (alarm[1] & 0x7F) == (reg[RTCSEC + 1] & 0x7F);
+    bool hour = (alarm[2] & 0x3F) == (reg[RTCSEC + 2] & 0x3F);
+    bool weekday = (alarm[3] & 0x07) == (reg[RTCWKDAY] & 0x07);
+    bool date = (alarm[4] & 0x3F) == (reg[RTCWKDAY + 1] & 0x3F);
+    bool month = (alarm[5] & 0x1F) == (reg[RTCMTH] & 0x1F);
+    bool match;
+    switch((alarm[3] >> 4) & 0x07) {
+      case 0: match = second; break;
+      case 1: match = minute; break;
+      case 2: match = hour; break;
+      case 3: match = weekday; break;
+      case 4: match = date; break;
+      case 7: match = second && minute && hour && weekday && date && month; break;
+      default: match = false;
+    }
+    if(match)
+      reg[ALM0WKDAY + 7 * n] |= ALMIF;
+  }
+}
+
+/*******************************************************************************************************************
+** Si7006                                                                                                         **
+*******************************************************************************************************************/
+
+// Si7006 commands
+#define MEASURE_RH_HOLD   0xE5
+#define MEASURE_RH        0xF5
+#define MEASURE_T_HOLD    0xE3
+#define MEASURE_T         0xF3
+#define PREVIOUS_T        0xE0
+
+uint8_t Si7006Model::write(const uint8_t* data, uint8_t len) {
+  if(!present)
+    return 2;
+  transactions++;
+  if(len == 0)
+    return 0;
+  _command = data[0];
+  if(_command == MEASURE_RH || _command == MEASURE_T) {
+    measure();
+    _readyAt = board.time() + conversionTime;
+  } else if(_command == MEASURE_RH_HOLD || _command == MEASURE_T_HOLD) {
+    measure();
+  }
+  return 0;
+}
+
+uint8_t Si7006Model::read(uint8_t* data, uint8_t len) {
+  if(!present)
+    return 0;
+  transactions++;
+  uint16_t value;
+  switch(_command) {
+    case MEASURE_RH:
+    case MEASURE_T:
+      if(board.time() < _readyAt)
+        return 0;                                  // Still converting, NACK
+      value = _command == MEASURE_RH ? _rawHumidity : _rawTemperature;
+      readings++;
+      break;
+    case MEASURE_RH_HOLD:
+    case MEASURE_T_HOLD:
+      board.spend(conversionTime);                 // Holds the clock low until it is done
+      value = _command == MEASURE_RH_HOLD ? _rawHumidity : _rawTemperature;
+      readings++;
+      break;
+    case PREVIOUS_T:
+      value = _rawTemperature;
+      break;
+    default:
+      value = 0xFFFF;
+  }
+  uint8_t bytes[3] = { (uint8_t)(value >> 8), (uint8_t)value, 0 };
+  for(uint8_t i=0;i<len;i++)
+    data[i] = i < 3 ? bytes[i] : 0xFF;
+  return len;
+}
+
+//Latches the readings, the sensor keeps the temperature from the last humidity measurement
+void Si7006Model::measure() {
+  double humidity = (this->humidity + 6) * 65536 / 125;
+  double temperature = (this->temperature + 46.85) * 65536 / 175.72;
+  _rawHumidity = (uint16_t)constrain(humidity, 0.0, 65532.0) & 0xFFFC;
+  _rawTemperature = (uint16_t)constrain(temperature, 0.0, 65532.0) & 0xFFFC;
+}
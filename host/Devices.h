@@ -0,0 +1,100 @@
+/*
+ * Nixie Clock Project
+ * MCP7940 and Si7006 models on the host build's I2C bus
+ *
+ * The Wire stub hands each transaction to the device at its address and charges the board the time the transfer
+ * takes at the bus speed, 9 bit times a byte plus start and stop.
+ *
+ * The MCP7940 model is a register file: timekeeping, control and alarm registers at 0x00-0x1F and the 64 bytes of
+ * SRAM at 0x20-0x5F, with the register pointer wrapping in each area the way the chip does. Setting ST starts the
+ * oscillator, OSCRUN follows startTime later, and from then on the time counts in BCD with the crystal's ppm error
+ * and the OSCTRIM fine trim applied. Each second the enabled alarms are compared in the fields their ALMxMSK selects
+ * and set their ALMxIF flag while they match. The MFP output follows CONTROL: the 1Hz square wave going low as each
+ * second starts, the alarm flags through ALMPOL, or the OUT bit. OSCRUN, PWRFAIL, LPYR and the ALMPOL copy in
+ * ALM1WKDAY can't be written.
+ *
+ * The Si7006 model answers the commands TTSi7006 sends. A no hold measurement NACKs reads until its conversion is
+ * done, the hold commands stretch the clock for the conversion instead.
+ *
+ * Either device can be taken off the bus with present = false, it then NACKs its address.
+ */
+
+#ifndef Devices_h
+#define Devices_h
+
+#include <stdint.h>
+
+#define MCP7940_MODEL_ADDRESS 0x6F
+#define SI7006_MODEL_ADDRESS  0x40
+#define MCP7940_MODEL_SIZE    0x60
+
+class Mcp7940Model {
+  public:
+    Mcp7940Model() { reset(); }
+
+    //Back to power on with no battery: registers and SRAM clear, oscillator stopped
+    void reset();
+
+    //Loads a time and starts the oscillator as if it had been running for a while, 24 hour mode, weekday 1-7
+    void setTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second,
+                 uint8_t weekday = 1);
+
+    //Time in the registers as seconds since 2000-01-01, for comparing against what a sketch shows
+    uint32_t seconds() const;
+    uint8_t field(uint8_t reg) const;               // BCD register without its control bits, as a number
+
+    bool oscillatorRunning() const;
+    bool mfp() const;                               // Output level, the pin is open drain so true is released
+    unsigned long nextEvent(unsigned long now) const; // Board time of the next increment, half second or start
+    void run(unsigned long now);                    // Catches up to a board time
+
+    // I2C, return values as Wire.endTransmission() and Wire.requestFrom()
+    uint8_t write(const uint8_t* data, uint8_t len);
+    uint8_t read(uint8_t* data, uint8_t len);
+
+    uint8_t reg[MCP7940_MODEL_SIZE];                // Registers and SRAM
+    bool present = true;
+    double ppm = 0;                                 // Crystal error, positive runs fast
+    unsigned long startTime = 2000;                 // us from ST being set to OSCRUN
+    unsigned long transactions = 0;                 // Writes and reads addressed to it
+    unsigned long writes = 0;                       // Transactions that wrote registers or SRAM
+    unsigned long timeReads = 0;                    // Reads of all seven timekeeping registers, now() calls
+
+  private:
+    uint8_t _pointer = 0;
+    double _phase = 0;                              // us into the current second, RTC time
+    unsigned long _last = 0;                        // Board time run() last caught up to
+    unsigned long _startAt = 0;                     // Board time OSCRUN comes on, 0 if not starting
+
+    double rate() const;
+    void store(uint8_t addr, uint8_t value);
+    uint8_t load(uint8_t addr) const;
+    void increment();
+    void matchAlarms();
+};
+
+class Si7006Model {
+  public:
+    uint8_t write(const uint8_t* data, uint8_t len);
+    uint8_t read(uint8_t* data, uint8_t len);
+
+    float temperature = 22.0;                       // C
+    float humidity = 45.0;                          // %RH
+    bool present = true;
+    unsigned long conversionTime = 20000;           // us for humidity and temperature
+    unsigned long transactions = 0;
+    unsigned long readings = 0;                     // Humidity and temperature results read back
+
+  private:
+    uint8_t _command = 0;
+    unsigned long _readyAt = 0;
+    uint16_t _rawHumidity = 0;
+    uint16_t _rawTemperature = 0;
+
+    void measure();
+};
+
+extern Mcp7940Model rtcModel;
+extern Si7006Model sensorModel;
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Nixie Clock Project
+ * FastLED controllers and colour conversion for the host build, see stubs/FastLED.h
+ */
+
+#include <FastLED.h>
+
+CFastLED FastLED;
+LedLog ledLog;
+
+void CLEDController::showLeds(uint8_t brightness) {
+  ledLog.pushes++;
+  ledLog.ledsPushed += _count;
+  if(ledLog.keep) {
+    LedFrame frame;
+    frame.time = millis();
+    frame.controller = _index;
+    frame.brightness = brightness;
+    for(int i=0;i<_count;i++) {
+      CRGB led = _leds[i];
+      for(uint8_t c=0;c<3;c++)
+        led.raw[c] = scale8(led.raw[c], brightness);
+      frame.leds.push_back(led);
+    }
+    ledLog.frames.push_back(frame);
+  }
+  board.spendBlocked((unsigned long)_count * LED_PUSH_TIME);
+}
+
+//FastLED's hsv2rgb_rainbow() C path, yellow boosted (Y1) and FASTLED_SCALE8_FIXED
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb) {
+  uint8_t hue = hsv.hue;
+  uint8_t sat = hsv.sat;
+  uint8_t val = hsv.val;
+
+  uint8_t offset8 = (hue & 0x1F) << 3;
+  uint8_t third = scale8(offset8, 256 / 3);
+  uint8_t twothirds = scale8(offset8, (256 * 2) / 3);
+  uint8_t r, g, b;
+
+  if(!(hue & 0x80)) {
+    if(!(hue & 0x40)) {
+      if(!(hue & 0x20)) {
+        r = 255 - third; g = third; b = 0;         // Red to orange
+      } else {
+        r = 171; g = 85 + third; b = 0;            // Orange to yellow
+      }
+    } else {
+      if(!(hue & 0x20)) {
+        r = 171 - twothirds; g = 170 + third; b = 0;  // Yellow to green
+      } else {
+        r = 0; g = 255 - third; b = third;         // Green to aqua
+      }
+    }
+  } else {
+    if(!(hue & 0x40)) {
+      if(!(hue & 0x20)) {
+        r = 0; g = 171 - twothirds; b = 85 + twothirds;  // Aqua to blue
+      } else {
+        r = third; g = 0; b = 255 - third;         // Blue to purple
+      }
+    } else {
+      if(!(hue & 0x20)) {
+        r = 85 + third; g = 0; b = 171 - third;    // Purple to pink
+      } else {
+        r = 170 + third; g = 0; b = 85 - third;    // Pink to red
+      }
+    }
+  }
+
+  if(sat != 255) {
+    if(sat == 0) {
+      r = 255; g = 255; b = 255;
+    } else {
+      if(r) r = scale8(r, sat);
+      if(g) g = scale8(g, sat);
+      if(b) b = scale8(b, sat);
+      uint8_t desat = 255 - sat;
+      desat = scale8(desat, desat);
+      r += desat;
+      g += desat;
+      b += desat;
+    }
+  }
+
+  if(val != 255) {
+    val = scale8_video(val, val);
+    if(val == 0) {
+      r = 0; g = 0; b = 0;
+    } else {
+      if(r) r = scale8(r, val);
+      if(g) g = scale8(g, val);
+      if(b) b = scale8(b, val);
+    }
+  }
+
+  rgb.r = r;
+  rgb.g = g;
+  rgb.b = b;
+}
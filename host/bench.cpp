@@ -0,0 +1,107 @@
+/*
+ * Nixie Clock Project
+ * Scripted scenarios for NixieClock on the virtual board, with the time each task and scheduler pass took
+ *
+ * The board charges time for the I2C transfers at 100kHz and the WS2812 pushes at 30us an LED with interrupts off,
+ * but nothing for the instructions in between, so a task that only computes shows 0us however slow it gets. The
+ * times are a bus and LED floor for each task, not cycle counts, and are no performance gate. Alongside them each
+ * scenario counts the calls on the paths that cost the most on the board: RTC time reads (MCP7940.now()), Si7006
+ * readings, updateColours() and tube pushes (FastLED show). Those counts do move when the sketch starts doing more
+ * work, and updateColours() is counted through -finstrument-functions, which the Makefile sets for this file only.
+ *
+ *   build/bench
+ */
+
+#include <Arduino.h>
+#include "Devices.h"
+#include "NixieClock.ino"
+
+#define CLAP_TIME         25000 // us a synthetic clap rings for
+
+static unsigned long claps[8];                   // Board times in us
+static uint8_t clapCount = 0;
+static unsigned long colourUpdates = 0;          // updateColours() calls
+
+//Called on entry to every function compiled in this file, which includes the sketch
+extern "C" __attribute__((no_instrument_function)) void __cyg_profile_func_enter(void* fn, void* caller) {
+  if(fn == (void*)updateColours)
+    colourUpdates++;
+}
+
+extern "C" __attribute__((no_instrument_function)) void __cyg_profile_func_exit(void* fn, void* caller) {}
+
+//Quiet room with a clap at each time in claps, a decaying burst of pseudo random noise
+static uint8_t audio(unsigned long time) {
+  static uint16_t lfsr = 0xACE1;
+  lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+  int noise = (int8_t)(lfsr & 0xFF);
+  int level = noise / 32;
+  for(uint8_t i=0;i<clapCount;i++) {
+    if(time >= claps[i] && time < claps[i] + CLAP_TIME)
+      level = noise * (long)(CLAP_TIME - (time - claps[i])) / CLAP_TIME;
+  }
+  return constrain(128 + level, 0, 255);
+}
+
+static void clapAt(unsigned long ms) {
+  if(clapCount < 8)
+    claps[clapCount++] = ms * 1000;
+}
+
+//Runs one scenario from its start and prints the task figures for it
+static void scenario(const char* name, unsigned long ms) {
+  unsigned long pushes = ledLog.pushes;
+  unsigned long transactions = Wire.transactions;
+  unsigned long timeReads = rtcModel.timeReads;
+  unsigned long readings = sensorModel.readings;
+  unsigned long colours = colourUpdates;
+  scheduler.resetStats();
+  board.run(loop, ms);
+  printf("%-14s %6lums  longest pass %5uus  I2C %4lu  calls: now() %lu Si7006 %lu updateColours() %lu show %lu\n",
+         name, ms, scheduler.worstPass(), Wire.transactions - transactions, rtcModel.timeReads - timeReads,
+         sensorModel.readings - readings, colourUpdates - colours, ledLog.pushes - pushes);
+  printf("%-14s bus and LED floor, typical/worst us:", "");
+  for(int8_t id=0;id<scheduler.capacity();id++) {
+    if(!scheduler.isScheduled(id) || scheduler.worstCase(id) == 0)
+      continue;
+    char task[16];
+    strncpy(task, (const char*)scheduler.name(id), sizeof(task) - 1);
+    task[sizeof(task) - 1] = 0;
+    printf(" %s %u/%uus", task, scheduler.typical(id), scheduler.worstCase(id));
+  }
+  printf("\n");
+}
+
+int main() {
+  printf("Task times only count I2C and LED push time, not instructions, so they are a floor and not a performance "
+         "gate\n");
+  rtcModel.setTime(2024, 6, 1, 12, 0, 0);
+  board.audio = audio;
+  setup();
+  scenario("boot", 2000);
+  scenario("idle", 20000);
+
+  unsigned long start = board.time() / 1000;
+  clapAt(start + 500);
+  clapAt(start + 900);
+  scenario("double clap", 12000);                // Found ~0.8s after the second, then the cycle fades through
+
+  start = board.time() / 1000;
+  board.press(start + 100, SW_SET_PIN, 800);       // Long press into set mode
+  for(uint8_t i=0;i<5;i++)
+    board.press(start + 1500 + i * 300, SW_UP_PIN, 100);
+  for(uint8_t i=0;i<6;i++)
+    board.press(start + 3500 + i * 400, SW_SET_PIN, 100);
+  scenario("set mode", 8000);
+
+  start = board.time() / 1000;
+  board.press(start + 100, SW_MODE_PIN, 100);      // Colour editor
+  board.press(start + 500, SW_UP_PIN, 2000);       // Hue, repeating
+  board.press(start + 3000, SW_MODE_PIN, 100);
+  board.press(start + 3500, SW_DOWN_PIN, 1500);    // Saturation
+  board.press(start + 5500, SW_MODE_PIN, 100);
+  scenario("colour editor", 8000);
+
+  board.report(stdout);
+  return 0;
+}
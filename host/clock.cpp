@@ -0,0 +1,76 @@
+/*
+ * Nixie Clock Project
+ * Runs NixieClock on the virtual board
+ *
+ *   build/clock [-s seconds] [-t "YYYY-MM-DD HH:MM:SS"] [-p pin:ms:held]... [-n] [-q] [-r]
+ *
+ *   -s  how long to run, 60s if not given
+ *   -t  time in the RTC at power on, it starts with its oscillator stopped and SRAM clear if not given
+ *   -p  presses a button: pin held high for held ms from ms after power on
+ *   -n  no RTC on the bus
+ *   -q  don't echo Serial
+ *   -r  report the energy account and the bus traffic at the end
+ */
+
+#include <Arduino.h>
+#include "Devices.h"
+#include "NixieClock.ino"
+
+static void printShown() {
+  printf("shown %04d-%02d-%02d %02d:%02d:%02d", now.year(), now.month(), now.day(), now.hour(), now.minute(),
+         now.second());
+  if(rtcModel.present && rtcModel.oscillatorRunning())
+    printf(", RTC %02d-%02d-%02d %02d:%02d:%02d", rtcModel.field(0x06), rtcModel.field(0x05), rtcModel.field(0x04),
+           rtcModel.field(0x02), rtcModel.field(0x01), rtcModel.field(0x00));
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  unsigned long seconds = 60;
+  bool report = false;
+  board.serialEcho = true;
+  for(int i=1;i<argc;i++) {
+    const char* option = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if(!strcmp(option, "-n")) {
+      rtcModel.present = false;
+    } else if(!strcmp(option, "-q")) {
+      board.serialEcho = false;
+    } else if(!strcmp(option, "-r")) {
+      report = true;
+    } else if(!strcmp(option, "-s") && value) {
+      seconds = strtoul(value, nullptr, 10);
+      i++;
+    } else if(!strcmp(option, "-t") && value) {
+      int year, month, day, hour, minute, second;
+      if(sscanf(value, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second) != 6) {
+        fprintf(stderr, "clock: -t wants \"YYYY-MM-DD HH:MM:SS\"\n");
+        return 2;
+      }
+      rtcModel.setTime(year, month, day, hour, minute, second);
+      i++;
+    } else if(!strcmp(option, "-p") && value) {
+      unsigned pin;
+      unsigned long ms, held;
+      if(sscanf(value, "%u:%lu:%lu", &pin, &ms, &held) != 3) {
+        fprintf(stderr, "clock: -p wants pin:ms:held\n");
+        return 2;
+      }
+      board.press(ms, pin, held);
+      i++;
+    } else {
+      fprintf(stderr, "clock: unknown option %s\n", option);
+      return 2;
+    }
+  }
+
+  setup();
+  board.run(loop, seconds * 1000);
+  printShown();
+  if(report) {
+    board.report(stdout);
+    printf("I2C transactions %lu, RTC %lu, sensor %lu, LED pushes %lu\n", Wire.transactions, rtcModel.transactions,
+           sensorModel.transactions, ledLog.pushes);
+  }
+  return 0;
+}
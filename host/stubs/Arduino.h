@@ -0,0 +1,155 @@
+/*
+ * Nixie Clock Project
+ * Arduino core for the host build
+ *
+ * Just enough of the AVR Arduino core for the sketches and the libraries to compile as plain C++. Time, the pins, the
+ * interrupt and ADC registers and Serial are all backed by the virtual board in Board.h, so millis() only moves when
+ * the board is advanced and an ISR only runs when the board delivers its interrupt.
+ *
+ * int is 32 bits and pointers are 64 bits here, so sizes and overflow points differ from the ATmega328. The RAM
+ * budgets in the sketch are only checked on the board for that reason.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <type_traits>
+
+#define ARDUINO           10813
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef void (*voidFuncPtr)(void);
+
+// Flash is ordinary memory here
+class __FlashStringHelper;
+#define PROGMEM
+#define PSTR(s)           (s)
+#define F(s)              ((const __FlashStringHelper*)(s))
+#define pgm_read_byte(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)  (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define memcpy_P          memcpy
+#define strcpy_P          strcpy
+#define strlen_P          strlen
+#define sprintf_P         sprintf
+
+#define HIGH              1
+#define LOW               0
+#define INPUT             0
+#define OUTPUT            1
+#define INPUT_PULLUP      2
+#define CHANGE            1
+#define FALLING           2
+#define RISING            3
+
+// Uno pin numbers
+#define A0                14
+#define A1                15
+#define A2                16
+#define A3                17
+#define A4                18
+#define A5                19
+#define A6                20
+#define A7                21
+
+#define bit(b)            (1UL << (b))
+#define bitRead(v, b)     (((v) >> (b)) & 0x01)
+#define bitSet(v, b)      ((v) |= (1UL << (b)))
+#define bitClear(v, b)    ((v) &= ~(1UL << (b)))
+#define bitWrite(v, b, x) ((x) ? bitSet(v, b) : bitClear(v, b))
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+// binary.h, only the constants the libraries use
+#define B111              7
+#define B11111000         248
+
+// Templates rather than the core's macros so the C++ standard headers still compile after this one
+template<class A, class B> inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template<class A, class B> inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+#define ISR(vector)       extern "C" void vector(void)
+
+#include "Board.h"
+
+// wiring.c, Timer0 counts these in its overflow interrupt
+extern volatile unsigned long timer0_millis;
+
+inline unsigned long millis() { return timer0_millis; }
+inline unsigned long micros() { return board.micros(); }
+inline void delay(unsigned long ms) { board.spend(ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { board.spend(us); }
+
+inline void pinMode(uint8_t pin, uint8_t mode) { board.pinMode(pin, mode); }
+inline int digitalRead(uint8_t pin) { return board.read(pin); }
+inline void digitalWrite(uint8_t pin, uint8_t level) { board.write(pin, level); }
+inline int analogRead(uint8_t pin) { return 512; }
+
+inline void cli() { board.disableInterrupts(); }
+inline void sei() { board.enableInterrupts(); }
+#define noInterrupts()    cli()
+#define interrupts()      sei()
+
+#define NOT_AN_INTERRUPT  -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+inline void attachInterrupt(uint8_t n, voidFuncPtr isr, int mode) { board.attach(n, isr, mode); }
+inline void detachInterrupt(uint8_t n) { board.detach(n); }
+
+// Ports as the Uno maps them: D0-D7 port D, D8-D13 port B, A0-A5 port C
+#define PB                2
+#define PC                3
+#define PD                4
+#define digitalPinToPort(p)       ((p) < 8 ? PD : ((p) < 14 ? PB : PC))
+#define portInputRegister(port)   ((port) == PB ? &PINB : ((port) == PC ? &PINC : &PIND))
+#define digitalPinToBitMask(p)    ((uint8_t)bit((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14)))
+#define digitalPinToPCICR(p)      (&PCICR)
+#define digitalPinToPCICRbit(p)   ((p) < 8 ? 2 : ((p) < 14 ? 0 : 1))
+#define digitalPinToPCMSK(p)      ((p) < 8 ? &PCMSK2 : ((p) < 14 ? &PCMSK0 : &PCMSK1))
+#define digitalPinToPCMSKbit(p)   ((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14))
+
+#define DEC               10
+#define HEX               16
+
+// Print and HardwareSerial in one, everything goes to the board's serial port
+class HardwareSerial {
+  public:
+    void begin(unsigned long baud) { board.serialOpen(true); }
+    void end() { board.serialOpen(false); }
+    void flush() {}
+    operator bool() { return true; }
+
+    size_t write(uint8_t c) { return board.serialWrite(&c, 1); }
+    size_t write(const uint8_t* data, size_t len) { return board.serialWrite(data, len); }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+    size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC) { return format(base == HEX ? "%lX" : "%ld", n); }
+    size_t print(unsigned long n, int base = DEC) { return format(base == HEX ? "%lX" : "%lu", n); }
+    size_t print(double n, int digits = 2) { return format("%.*f", digits, n); }
+
+    template<class T> size_t println(T value) { return print(value) + println(); }
+    template<class T> size_t println(T value, int base) { return print(value, base) + println(); }
+    size_t println() { return write("\r\n"); }
+
+  private:
+    template<class... T> size_t format(const char* spec, T... values) {
+      char text[32];
+      snprintf(text, sizeof(text), spec, values...);
+      return write(text);
+    }
+};
+
+extern HardwareSerial Serial;
+
+#endif
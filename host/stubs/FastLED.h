@@ -0,0 +1,243 @@
+/*
+ * Nixie Clock Project
+ * FastLED for the host build
+ *
+ * The colour maths is FastLED's C code with FASTLED_SCALE8_FIXED and FASTLED_BLEND_FIXED set, so colours match the
+ * AVR build bit for bit. A controller doesn't drive a pin, showLeds() records the push in ledLog with the LEDs as
+ * they would go out, scaled by the brightness, and holds the board with interrupts off for the 30us each WS2812 LED
+ * takes to clock out.
+ */
+
+#ifndef __INC_FASTSPI_LED2_H
+#define __INC_FASTSPI_LED2_H
+
+#include <Arduino.h>
+#include <vector>
+
+#define FASTLED_SCALE8_FIXED  1
+#define FASTLED_BLEND_FIXED   1
+#define FASTLED_CONTROLLERS   8
+#define LED_PUSH_TIME         30    // us per WS2812 LED, 24 bits at 800kHz plus the reset share
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale) {
+  return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale) {
+  return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  unsigned t = i + j;
+  return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+  return i > j ? i - j : 0;
+}
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+  uint16_t partial = (a << 8) | b;
+  partial += b * amountOfB;
+  partial -= a * amountOfB;
+  return partial >> 8;
+}
+
+inline uint8_t sin8(uint8_t theta) {
+  return 128 + 127.5 * sin(theta * 2 * M_PI / 256);
+}
+
+inline uint8_t beatsin8(uint8_t bpm, uint8_t low = 0, uint8_t high = 255) {
+  uint8_t beat = (millis() * bpm * 256UL) / 60000;
+  return low + scale8(sin8(beat), high - low);
+}
+
+struct CRGB;
+
+struct CHSV {
+  union {
+    struct {
+      union { uint8_t hue; uint8_t h; };
+      union { uint8_t sat; uint8_t s; };
+      union { uint8_t val; uint8_t v; };
+    };
+    uint8_t raw[3];
+  };
+
+  CHSV() {}
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+};
+
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+struct CRGB {
+  union {
+    struct {
+      union { uint8_t r; uint8_t red; };
+      union { uint8_t g; uint8_t green; };
+      union { uint8_t b; uint8_t blue; };
+    };
+    uint8_t raw[3];
+  };
+
+  enum HTMLColorCode {
+    Black = 0x000000,
+    Indigo = 0x4B0082,
+    Orange = 0xFFA500,
+    Red = 0xFF0000,
+    White = 0xFFFFFF
+  };
+
+  CRGB() {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(uint32_t colorcode) : r(colorcode >> 16), g(colorcode >> 8), b(colorcode) {}
+  CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode) {}
+  CRGB(const CHSV& rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+  CRGB& operator=(const CHSV& rhs) {
+    hsv2rgb_rainbow(rhs, *this);
+    return *this;
+  }
+
+  uint8_t& operator[](uint8_t x) { return raw[x]; }
+  const uint8_t& operator[](uint8_t x) const { return raw[x]; }
+
+  CRGB& nscale8_video(uint8_t scaledown) {
+    uint8_t nonzeroscale = scaledown != 0 ? 1 : 0;
+    for(uint8_t c=0;c<3;c++)
+      raw[c] = raw[c] == 0 ? 0 : ((raw[c] * scaledown) >> 8) + nonzeroscale;
+    return *this;
+  }
+
+  CRGB& nscale8(uint8_t scaledown) {
+    for(uint8_t c=0;c<3;c++)
+      raw[c] = scale8(raw[c], scaledown);
+    return *this;
+  }
+};
+
+inline bool operator==(const CRGB& lhs, const CRGB& rhs) {
+  return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b;
+}
+
+inline bool operator!=(const CRGB& lhs, const CRGB& rhs) {
+  return !(lhs == rhs);
+}
+
+inline CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amountOfP2) {
+  if(amountOfP2 == 0)
+    return p1;
+  if(amountOfP2 == 255)
+    return p2;
+  return CRGB(blend8(p1.r, p2.r, amountOfP2), blend8(p1.g, p2.g, amountOfP2), blend8(p1.b, p2.b, amountOfP2));
+}
+
+inline void fill_solid(CRGB* leds, int numToFill, const CRGB& color) {
+  for(int i=0;i<numToFill;i++)
+    leds[i] = color;
+}
+
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+
+// One push as it went out on the data pin
+struct LedFrame {
+  unsigned long time;         // Board time in ms
+  uint8_t controller;
+  uint8_t brightness;
+  std::vector<CRGB> leds;     // Scaled by the brightness, in strip order before the colour order is applied
+};
+
+// Every push made by the controllers
+struct LedLog {
+  unsigned long pushes = 0;
+  unsigned long ledsPushed = 0;
+  bool keep = false;          // Keep each push in frames
+  std::vector<LedFrame> frames;
+
+  void clear() {
+    pushes = 0;
+    ledsPushed = 0;
+    frames.clear();
+  }
+};
+
+extern LedLog ledLog;
+
+class CLEDController {
+  public:
+    void init(uint8_t index, uint8_t pin, CRGB* leds, int count) {
+      _index = index;
+      _pin = pin;
+      _leds = leds;
+      _count = count;
+    }
+
+    void showLeds(uint8_t brightness = 255);
+
+    CRGB* leds() { return _leds; }
+    int size() const { return _count; }
+    uint8_t pin() const { return _pin; }
+
+  private:
+    uint8_t _index = 0;
+    uint8_t _pin = 0;
+    CRGB* _leds = nullptr;
+    int _count = 0;
+};
+
+template<uint8_t DATA_PIN, EOrder RGB_ORDER = GRB> class WS2812B {};
+template<uint8_t DATA_PIN, EOrder RGB_ORDER = GRB> class WS2812 {};
+
+class CFastLED {
+  public:
+    template<template<uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+    CLEDController& addLeds(CRGB* data, int nLedsOrOffset, int nLedsIfOffset = 0) {
+      int offset = nLedsIfOffset > 0 ? nLedsOrOffset : 0;
+      int count = nLedsIfOffset > 0 ? nLedsIfOffset : nLedsOrOffset;
+      if(_count >= FASTLED_CONTROLLERS) {
+        printf("FastLED: more than %d controllers\n", FASTLED_CONTROLLERS);
+        exit(2);
+      }
+      CLEDController& controller = _controllers[_count];
+      controller.init(_count, DATA_PIN, data + offset, count);
+      _count++;
+      return controller;
+    }
+
+    void setBrightness(uint8_t scale) { _brightness = scale; }
+    uint8_t getBrightness() { return _brightness; }
+    void setDither(uint8_t ditherMode) {}
+
+    void show(uint8_t scale) {
+      for(uint8_t i=0;i<_count;i++)
+        _controllers[i].showLeds(scale);
+    }
+    void show() { show(_brightness); }
+
+    void clear(bool writeData = false) {
+      for(uint8_t i=0;i<_count;i++)
+        fill_solid(_controllers[i].leds(), _controllers[i].size(), CRGB::Black);
+      if(writeData)
+        show(0);
+    }
+
+    int count() { return _count; }
+    CLEDController& operator[](int x) { return _controllers[x]; }
+
+    //Back to no controllers, for a fresh start between tests
+    void reset() {
+      _count = 0;
+      _brightness = 255;
+    }
+
+  private:
+    CLEDController _controllers[FASTLED_CONTROLLERS];
+    uint8_t _count = 0;
+    uint8_t _brightness = 255;
+};
+
+extern CFastLED FastLED;
+
+#endif
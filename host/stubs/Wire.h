@@ -0,0 +1,65 @@
+/*
+ * Nixie Clock Project
+ * Wire for the host build, transactions go to the device models in Devices.h
+ */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <Arduino.h>
+
+#define BUFFER_LENGTH     32
+
+class TwoWire {
+  public:
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t clock) { _clock = clock; }
+
+    void beginTransmission(uint8_t address) {
+      _address = address;
+      _txLength = 0;
+    }
+
+    size_t write(uint8_t data) {
+      if(_txLength >= BUFFER_LENGTH)
+        return 0;
+      _tx[_txLength++] = data;
+      return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t len) {
+      size_t sent = 0;
+      while(sent < len && write(data[sent]))
+        sent++;
+      return sent;
+    }
+
+    uint8_t endTransmission(uint8_t sendStop = true);
+
+    template<class A, class N> uint8_t requestFrom(A address, N quantity, uint8_t sendStop = true) {
+      return request((uint8_t)address, (uint8_t)quantity);
+    }
+
+    int available() { return _rxLength - _rxIndex; }
+    int read() { return _rxIndex < _rxLength ? _rx[_rxIndex++] : -1; }
+    int peek() { return _rxIndex < _rxLength ? _rx[_rxIndex] : -1; }
+
+    unsigned long transactions = 0;
+
+  private:
+    uint32_t _clock = 100000;
+    uint8_t _address = 0;
+    uint8_t _tx[BUFFER_LENGTH];
+    uint8_t _txLength = 0;
+    uint8_t _rx[BUFFER_LENGTH];
+    uint8_t _rxLength = 0;
+    uint8_t _rxIndex = 0;
+
+    uint8_t request(uint8_t address, uint8_t quantity);
+    void transfer(uint8_t bytes);
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Nixie Clock Project
+ * avr/sleep.h for the host build, sleep_cpu() hands the time over to the virtual board until an interrupt
+ */
+
+#ifndef _AVR_SLEEP_H_
+#define _AVR_SLEEP_H_
+
+#include <Arduino.h>
+
+#define SLEEP_MODE_IDLE       0
+#define SLEEP_MODE_ADC        1
+#define SLEEP_MODE_PWR_DOWN   2
+#define SLEEP_MODE_PWR_SAVE   3
+#define SLEEP_MODE_STANDBY    6
+#define SLEEP_MODE_EXT_STANDBY 7
+
+extern uint8_t sleepMode;
+extern bool sleepEnabled;
+
+inline void set_sleep_mode(uint8_t mode) { sleepMode = mode; }
+inline void sleep_enable() { sleepEnabled = true; }
+inline void sleep_disable() { sleepEnabled = false; }
+inline void sleep_cpu() { board.sleep(sleepMode); }
+inline void sleep_bod_disable() {}
+#define sleep_mode() do { sleep_enable(); sleep_cpu(); sleep_disable(); } while(0)
+
+#endif
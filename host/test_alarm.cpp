@@ -0,0 +1,111 @@
+/*
+ * Nixie Clock Project
+ * DailyAlarm and alarmMatches() against the MCP7940 model
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "Alarm.h"
+
+MCP7940_Class MCP7940;
+
+//Polls the flag once a second for seconds, the way the sketch services the MFP interrupt, returns how often it rang
+static unsigned serviceFor(DailyAlarm& alarm, unsigned long seconds) {
+  unsigned rang = 0;
+  for(unsigned long i=0;i<seconds;i++) {
+    board.spend(1000000);
+    if(alarm.service(MCP7940, MCP7940.now()))
+      rang++;
+  }
+  return rang;
+}
+
+static void testMatches() {
+  DateTime alarm(2024, 3, 15, 7, 30, 20);        // A Friday
+  DateTime same(2024, 3, 15, 7, 30, 20);
+  CHECK(alarmMatches(ALARM_MATCH_SECOND, alarm, DateTime(2025, 1, 1, 0, 0, 20)));
+  CHECK(!alarmMatches(ALARM_MATCH_SECOND, alarm, DateTime(2024, 3, 15, 7, 30, 21)));
+  CHECK(alarmMatches(ALARM_MATCH_MINUTE, alarm, DateTime(2025, 1, 1, 23, 30, 59)));
+  CHECK(!alarmMatches(ALARM_MATCH_MINUTE, alarm, DateTime(2024, 3, 15, 7, 29, 59)));
+  CHECK(!alarmMatches(ALARM_MATCH_MINUTE, alarm, DateTime(2024, 3, 15, 7, 31, 0)));
+  CHECK(alarmMatches(ALARM_MATCH_HOUR, alarm, DateTime(2025, 1, 1, 7, 0, 0)));
+  CHECK(!alarmMatches(ALARM_MATCH_HOUR, alarm, DateTime(2024, 3, 15, 19, 30, 20)));
+  CHECK(alarmMatches(ALARM_MATCH_WEEKDAY, alarm, DateTime(2024, 3, 22)));
+  CHECK(!alarmMatches(ALARM_MATCH_WEEKDAY, alarm, DateTime(2024, 3, 16)));
+  CHECK(alarmMatches(ALARM_MATCH_DATE, alarm, DateTime(2024, 4, 15)));
+  CHECK(!alarmMatches(ALARM_MATCH_DATE, alarm, DateTime(2024, 3, 16)));
+  CHECK(alarmMatches(ALARM_MATCH_ALL, alarm, same));
+  CHECK(!alarmMatches(ALARM_MATCH_ALL, alarm, DateTime(2024, 4, 15, 7, 30, 20)));
+  CHECK(!alarmMatches(ALARM_MATCH_ALL, alarm, DateTime(2024, 3, 15, 7, 30, 21)));
+  CHECK(!alarmMatches(5, alarm, same));             // Reserved
+  CHECK(!alarmMatches(6, alarm, same));
+}
+
+static void testCheck() {
+  DailyAlarm alarm;
+  alarm.adjust(DATETIME_HOUR, 7);
+  alarm.adjust(DATETIME_MINUTE, 30);
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 7, 30, 0)));  // Off
+  alarm.setOn(true);
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 7, 29, 59)));
+  CHECK(alarm.check(DateTime(2024, 3, 15, 7, 30, 0)));
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 7, 30, 1)));  // Once in the minute
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 7, 30, 59)));
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 7, 31, 0)));
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 8, 30, 0)));  // Other hours
+  CHECK(!alarm.check(DateTime(2024, 3, 15, 19, 30, 0)));
+  CHECK(alarm.check(DateTime(2024, 3, 16, 7, 30, 0)));   // Re-armed the next day
+  CHECK(alarm.check(DateTime(2024, 3, 17, 7, 30, 42))); // Coming in part way through the minute
+  alarm.adjust(DATETIME_MINUTE, 1);                      // Changed, can go off again the same day
+  CHECK(alarm.check(DateTime(2024, 3, 17, 7, 31, 0)));
+  alarm.setOn(false);
+  alarm.setOn(true);
+  CHECK(alarm.check(DateTime(2024, 3, 17, 7, 31, 5)));
+}
+
+//Alarm set within its own hour, then the sketch reset in that hour with the alarm only in the registers
+static void testService() {
+  rtcModel.setTime(2024, 3, 15, 7, 10, 0);
+  CHECK(MCP7940.begin());
+  MCP7940.setAlarmPolarity(true);
+
+  DailyAlarm alarm;
+  alarm.adjust(DATETIME_HOUR, 7);
+  alarm.adjust(DATETIME_MINUTE, 12);
+  alarm.setOn(true);
+  alarm.save(MCP7940);
+  CHECK(!(rtcModel.reg[0x07] & 0x20));             // ALM1 off
+  CHECK(rtcModel.reg[0x07] & 0x10);                // ALM0 on
+  CHECK_EQUAL(0x07, rtcModel.reg[0x0C]);           // Hour kept in ALM0HOUR
+  CHECK_EQUAL(1, (rtcModel.reg[0x0D] >> 4) & 7);   // Matching the minute
+
+  CHECK_EQUAL(0, serviceFor(alarm, 115));          // Up to 07:11:55
+  CHECK_EQUAL(1, serviceFor(alarm, 70));           // Through 07:12, once
+  CHECK(rtcModel.mfp() == false);                  // Flag cleared, MFP back low
+  CHECK_EQUAL(0, serviceFor(alarm, 3600 - 185));   // 08:12 is the wrong hour
+  CHECK_EQUAL(0, serviceFor(alarm, 3600));
+
+  rtcModel.setTime(2024, 3, 15, 7, 11, 30);        // Reset in the alarm hour
+  DailyAlarm reloaded;
+  reloaded.load(MCP7940);
+  CHECK(reloaded.on());
+  CHECK_EQUAL(7, reloaded.time().hour());
+  CHECK_EQUAL(12, reloaded.time().minute());
+  CHECK_EQUAL(1, serviceFor(reloaded, 60));
+
+  rtcModel.setTime(2024, 3, 16, 7, 11, 30);        // And the next day
+  CHECK_EQUAL(1, serviceFor(reloaded, 60));
+
+  reloaded.setOn(false);
+  reloaded.save(MCP7940);
+  reloaded.load(MCP7940);
+  CHECK(!reloaded.on());
+}
+
+int main() {
+  testMatches();
+  testCheck();
+  testService();
+  return checkResult("alarm");
+}
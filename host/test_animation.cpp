@@ -0,0 +1,95 @@
+/*
+ * Nixie Clock Project
+ * Tweens replayed against time traces: the frames depend on the times alone, not on how often they are sampled
+ */
+
+#include <Arduino.h>
+#include <vector>
+#include "Check.h"
+#include "Animation.h"
+
+static unsigned done;
+
+static void finished() {
+  done++;
+}
+
+//Values at each time in the trace, with the tween started at the first one
+static std::vector<uint8_t> replay(const std::vector<unsigned long>& times, uint8_t curve, uint8_t mode) {
+  Tween tween;
+  std::vector<uint8_t> values;
+  tween.start(times[0], 10, 250, 400, curve, mode, finished);
+  for(unsigned long t : times) {
+    tween.update(t);
+    values.push_back(tween.value());
+  }
+  return values;
+}
+
+//A trace of passes that each take between 1 and jitter ms, like loop() with I2C and LED pushes in it
+static std::vector<unsigned long> trace(unsigned long start, unsigned long length, unsigned jitter) {
+  std::vector<unsigned long> times;
+  uint32_t seed = jitter;
+  for(unsigned long t=start;t<start+length;) {
+    times.push_back(t);
+    seed = seed * 1103515245 + 12345;
+    t += 1 + (seed >> 16) % jitter;
+  }
+  return times;
+}
+
+static void testReplay() {
+  for(uint8_t curve=0;curve<EASE_CURVES;curve++) {
+    for(uint8_t mode=TWEEN_ONCE;mode<=TWEEN_PINGPONG;mode++) {
+      std::vector<unsigned long> every = trace(4294966000UL, 2000, 1);  // Across the millis() wrap
+      std::vector<uint8_t> reference = replay(every, curve, mode);
+      CHECK(reference == replay(every, curve, mode));                  // Same times, same frames
+      for(unsigned jitter : { 3, 17, 45 }) {
+        std::vector<unsigned long> sparse = trace(4294966000UL, 2000, jitter);
+        std::vector<uint8_t> values = replay(sparse, curve, mode);
+        unsigned mismatches = 0;
+        for(size_t i=0;i<sparse.size();i++)
+          mismatches += values[i] != reference[sparse[i] - sparse[0]];
+        CHECK_EQUAL(0, mismatches);
+      }
+    }
+  }
+}
+
+static void testEnds() {
+  Tween tween;
+  done = 0;
+  tween.start(1000, 10, 250, 400, EASE_IN_OUT, TWEEN_ONCE, finished);
+  CHECK_EQUAL(10, tween.value());
+  tween.update(1000);
+  CHECK_EQUAL(10, tween.value());
+  tween.update(1200);
+  CHECK(tween.value() > 120 && tween.value() < 140);
+  tween.update(1399);
+  CHECK(tween.active());
+  tween.update(5000);                              // Late update still lands on the end, once
+  CHECK_EQUAL(250, tween.value());
+  CHECK(!tween.active());
+  CHECK_EQUAL(1, done);
+  CHECK(!tween.update(6000));
+  CHECK_EQUAL(1, done);
+
+  tween.start(0, 255, 0, 100, EASE_LINEAR, TWEEN_PINGPONG);
+  tween.update(50);
+  uint8_t down = tween.value();
+  tween.update(150);                               // Half way back up, rounded the other way
+  CHECK(abs(down - tween.value()) <= 2);
+  tween.update(200);
+  CHECK_EQUAL(255, tween.value());
+  tween.stop();
+  CHECK(!tween.update(250));
+  CHECK_EQUAL(255, tween.value());
+  tween.set(42);
+  CHECK_EQUAL(42, tween.value());
+}
+
+int main() {
+  testReplay();
+  testEnds();
+  return checkResult("animation");
+}
@@ -0,0 +1,39 @@
+/*
+ * Nixie Clock Project
+ * Boots NixieClock against a running RTC and checks the time and the tubes follow it
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "NixieClock.ino"
+
+int main() {
+  rtcModel.setTime(2024, 2, 29, 12, 59, 50, 4);
+  ledLog.keep = true;
+  setup();
+  CHECK(ledLog.pushes > 0);                        // First frame goes out before the RTC is looked for
+  bool firstLit = false;                           // and shows the time straight away, not a crossfade from blank
+  for(const CRGB &led : ledLog.frames.front().leds)
+    firstLit |= led.r || led.g || led.b;
+  CHECK(firstLit);
+  CHECK(!rtcReady);
+
+  board.run(loop, 1000);
+  CHECK(rtcReady);
+  CHECK_EQUAL(rtcModel.seconds(), now.unixtime() - SECONDS_FROM_1970_TO_2000);
+
+  board.run(loop, 15000);                          // Over the hour
+  CHECK_EQUAL(29, now.day());
+  CHECK_EQUAL(13, now.hour());
+  CHECK_EQUAL(0, now.minute());
+  CHECK_EQUAL(rtcModel.seconds(), now.unixtime() - SECONDS_FROM_1970_TO_2000);
+
+  const LedFrame &last = ledLog.frames.back();
+  CHECK(last.time > 15000);
+  bool lit = false;
+  for(const CRGB &led : last.leds)
+    lit |= led.r || led.g || led.b;
+  CHECK(lit);
+  return checkResult("boot");
+}
@@ -0,0 +1,75 @@
+/*
+ * Nixie Clock Project
+ * MCP7940 drift calibration against a crystal with a known error
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "MCP7940.h"
+
+MCP7940_Class MCP7940;
+
+#define DAY 86400UL
+
+static const uint32_t start = DateTime(2024, 6, 1, 12, 0, 0).unixtime();
+static unsigned long real;                         // Board time at start
+
+//Lets the RTC run for seconds of real time plus ms, returns the real time to the second, as it is set by hand
+static DateTime pass(uint32_t seconds, uint16_t ms = 0) {
+  board.powerDown(seconds * 1000000UL + ms * 1000UL);
+  return DateTime(start + (board.time() - real) / 1000000);
+}
+
+static int32_t gained(const DateTime& truth) {
+  return (int32_t)(MCP7940.now().unixtime() - truth.unixtime());
+}
+
+//A sketch that never calibrates can use all of SRAM, setting the time leaves the record bytes alone
+static void testRamLeftAlone() {
+  rtcModel.reset();
+  CHECK(MCP7940.begin());
+  uint8_t pattern[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  CHECK_EQUAL(8, MCP7940.writeRAM(MCP7940_CAL_RAM_ADDR, pattern, sizeof(pattern)));
+  unsigned long writes = rtcModel.writes;
+  MCP7940.adjust(DateTime(2024, 6, 1, 12, 0, 0));
+  CHECK(memcmp(pattern, &rtcModel.reg[0x20 + MCP7940_CAL_RAM_ADDR], sizeof(pattern)) == 0);
+  CHECK_EQUAL(2, rtcModel.writes - writes);        // Only stopping the oscillator and the timekeeping burst
+  CHECK_EQUAL(0, MCP7940.getSetUnixTime());
+}
+
+//Setting the time by hand once a day, the way the sketch's set mode does, walks the trim in on the crystal error
+static void testConvergence(double ppm) {
+  rtcModel.reset();
+  rtcModel.ppm = ppm;
+  CHECK(MCP7940.begin());
+  real = board.time();
+  DateTime truth = pass(0, 500);
+  MCP7940.calibrateOrAdjust(truth);                // Starts the record
+  CHECK_EQUAL(truth.unixtime(), MCP7940.getSetUnixTime());
+
+  for(uint8_t day=0;day<120;day++) {             // Slower as the drift left gets near the reading error
+    truth = pass(DAY, day * 389 % 1000);           // Set at any point in the second
+    MCP7940.calibrateOrAdjust(truth);
+    CHECK(abs(gained(truth)) <= 1);
+  }
+  double ideal = ppm * 32768 * 60 / 2 / 1e6;
+  CHECK(fabs(MCP7940.getCalibrationTrim() - ideal) <= 1.5);  // Within a step or so
+
+  unsigned long writes = rtcModel.writes;
+  truth = pass(60, 300);
+  MCP7940.calibrateOrAdjust(truth);                // Right to the second, nothing to write
+  CHECK_EQUAL(writes, rtcModel.writes);
+
+  truth = pass(30 * DAY);                          // A month on its own keeps within a few seconds
+  CHECK(abs(gained(truth)) <= 3);
+}
+
+int main() {
+  testRamLeftAlone();
+  testConvergence(20);
+  testConvergence(-35);
+  testConvergence(3);
+  testConvergence(0);
+  return checkResult("calibration");
+}
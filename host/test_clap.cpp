@@ -0,0 +1,137 @@
+/*
+ * Nixie Clock Project
+ * ClapDetector on synthetic ADC traces: claps, echoes, talking and a door slam over room noise
+ *
+ * Traces are built at the ADC's 9615Hz from pseudo random noise shaped by an envelope, a clap being a few
+ * milliseconds of attack and a ~15ms decay, talking syllables of ~150ms, and a slam a loud 300ms rumble.
+ */
+
+#include <Arduino.h>
+#include <vector>
+#include "Check.h"
+#include "Clap.h"
+
+#define ADC_RATE 9615                              // 16MHz / 128 / 13
+
+class Trace {
+  public:
+    explicit Trace(uint8_t noise = 3) : _noise(noise) {}
+
+    //A clap at ms, peak deviation from mid rail
+    Trace& clap(unsigned ms, uint8_t level = 110) {
+      add(ms, 2, 15, 30, level);
+      return *this;
+    }
+
+    //Talking from ms for length, syllables at about 6 a second
+    Trace& talk(unsigned ms, unsigned length, uint8_t level = 60) {
+      for(unsigned t=0;t<length;t+=170)
+        add(ms + t, 30, 60, 150, level);
+      return *this;
+    }
+
+    Trace& slam(unsigned ms, uint8_t level = 120) {
+      add(ms, 3, 120, 300, level);
+      return *this;
+    }
+
+    //Runs the trace through a detector, returns every pattern it reported
+    std::vector<uint8_t> detect(unsigned ms, ClapDetector& detector) {
+      std::vector<uint8_t> found;
+      unsigned samples = (unsigned long)ms * ADC_RATE / 1000;
+      for(unsigned i=0;i<samples;i++) {
+        detector.sample(value(i));
+        if(i % 64 == 63) {                         // loop() comes round well before the buffer fills
+          uint8_t claps = detector.update();
+          if(claps)
+            found.push_back(claps);
+        }
+      }
+      return found;
+    }
+
+    std::vector<uint8_t> detect(unsigned ms) {
+      ClapDetector detector;
+      return detect(ms, detector);
+    }
+
+  private:
+    struct Event {
+      unsigned start, attack, decay, length;       // Samples
+      uint8_t level;
+    };
+    std::vector<Event> _events;
+    uint8_t _noise;
+    uint32_t _lfsr = 0x1234567;
+
+    void add(unsigned ms, unsigned attack, unsigned decay, unsigned length, uint8_t level) {
+      _events.push_back({ ms * ADC_RATE / 1000, attack * ADC_RATE / 1000, decay * ADC_RATE / 1000,
+                          length * ADC_RATE / 1000, level });
+    }
+
+    int8_t noise() {
+      _lfsr = _lfsr * 1103515245 + 12345;
+      return (int8_t)(_lfsr >> 16);
+    }
+
+    uint8_t value(unsigned i) {
+      double envelope = 0;
+      for(const Event& event : _events) {
+        if(i < event.start || i >= event.start + event.length)
+          continue;
+        unsigned t = i - event.start;
+        double level = t < event.attack ? (double)t / event.attack : exp(-(double)(t - event.attack) / event.decay);
+        envelope = max(envelope, level * event.level);
+      }
+      int n = noise();
+      int v = 128 + n * _noise / 128 + (int)(n * envelope / 128);
+      return constrain(v, 0, 255);
+    }
+};
+
+static bool only(const std::vector<uint8_t>& found, uint8_t claps) {
+  return found.size() == 1 && found[0] == claps;
+}
+
+static void testPatterns() {
+  CHECK(only(Trace().clap(1000).clap(1400).detect(3000), 2));
+  CHECK(only(Trace().clap(1000).clap(1300).clap(1650).detect(3000), 3));
+  CHECK(only(Trace().clap(1000).clap(1180).detect(3000), 2));           // Just over CLAP_MIN_GAP
+  CHECK(only(Trace().clap(1000).clap(1750).detect(3000), 2));           // Just under CLAP_MAX_GAP
+  CHECK(Trace().clap(1000).detect(3000).empty());                       // One clap is nothing
+  CHECK(Trace().clap(1000).clap(1300).clap(1600).clap(1900).detect(3000).empty());  // Too many
+  CHECK(Trace().clap(1000).clap(1080).detect(3000).empty());            // An echo is the same clap
+  CHECK(Trace().clap(1000).clap(2000).detect(3500).empty());            // Too far apart
+  CHECK(only(Trace().clap(1000).clap(2000).clap(2400).detect(4000), 2)); // The late one starts again
+}
+
+static void testNotClaps() {
+  CHECK(Trace().talk(500, 3000).detect(4500).empty());                  // Syllables build up too slowly
+  CHECK(Trace().talk(500, 3000, 100).detect(4500).empty());
+  CHECK(Trace().slam(1000).slam(1400).detect(3000).empty());
+  CHECK(Trace().clap(1000).slam(1400).detect(3000).empty());            // A slam cancels the pattern
+  CHECK(only(Trace().talk(500, 2000).clap(3500).clap(3900).detect(5500), 2));  // Clapping once it's quiet
+  CHECK(only(Trace(10).clap(1000).clap(1400).detect(3000), 2));         // Noisy room
+  CHECK(Trace(20).clap(1000, 40).clap(1400, 40).detect(3000).empty());  // Lost in it
+}
+
+//reset() between the claps, as the sketch does when it starts listening again, throws the first one away
+static void testReset() {
+  Trace trace;
+  trace.clap(1000).clap(1400);
+  ClapDetector detector;
+  std::vector<uint8_t> found = trace.detect(1200, detector);
+  detector.reset();
+  Trace rest;                                      // Rest of the same recording from 1200ms
+  rest.clap(200);
+  std::vector<uint8_t> after = rest.detect(2000, detector);
+  CHECK(found.empty());
+  CHECK(after.empty());
+}
+
+int main() {
+  testPatterns();
+  testNotClaps();
+  testReset();
+  return checkResult("clap");
+}
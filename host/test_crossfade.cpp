@@ -0,0 +1,85 @@
+/*
+ * Nixie Clock Project
+ * TubeList crossfades, the colour split between the old and new digit and the frames a fade pushes
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "TubeDisplay.h"
+
+#define LEDS              10
+
+//Opens up the display list so the frames can be checked without LEDs behind them
+class Tubes : public TubeList<2, LEDS, nullptr> {
+  public:
+    using TubeList::split;
+    using TubeList::update;
+    using TubeList::expand;
+};
+
+static const CRGB colours[] = { CRGB(255, 120, 7), CRGB(0, 200, 33) };
+
+//The two parts always add back up to the colour, and the part grows with the level
+static void testSplit() {
+  for(const CRGB &colour : colours) {
+    uint8_t last[3] = { 0, 0, 0 };
+    for(int level=0;level<256;level++) {
+      CRGB part, rest;
+      Tubes::split(colour, level, part, rest);
+      for(uint8_t c=0;c<3;c++) {
+        CHECK_EQUAL(colour.raw[c], part.raw[c] + rest.raw[c]);
+        CHECK(part.raw[c] >= last[c]);
+        last[c] = part.raw[c];
+      }
+    }
+    CRGB part, rest;
+    Tubes::split(colour, 0, part, rest);
+    CHECK(part == CRGB(0, 0, 0));
+  }
+}
+
+//Steps a frame at a time from 9 to 0 on tube 0, the pair of LEDs lit always adds up to one digit's colour
+static void testFade(bool snap) {
+  Tubes tubes;
+  tubes.setCrossfade(150);
+  timer0_millis = 65500;                           // Fade start wraps the 16 bit time
+  tubes.set(0, 9, 0);
+  tubes.set(1, 5, 1);
+  CHECK_EQUAL(3, tubes.update(200, colours, TUBE_ALL_COLOURS));
+  timer0_millis += 200;
+  CHECK_EQUAL(3, tubes.update(200, colours, 0));   // Faded in from blank, the last fading frame
+  CHECK_EQUAL(0, tubes.update(200, colours, 0));
+
+  tubes.set(0, 0, 0);
+  if(snap)
+    tubes.snap();
+  CRGB leds[LEDS];
+  uint8_t frames = 0, lastNew = 0;
+  for(;;) {
+    uint8_t changed = tubes.update(200, colours, 0);
+    CHECK(!(changed & 2));                         // The other tube stays put
+    if(!changed)
+      break;
+    frames++;
+    tubes.expand(0, leds, colours);
+    for(uint8_t c=0;c<3;c++)
+      CHECK_EQUAL(colours[0].raw[c], leds[9].raw[c] + leds[0].raw[c]);
+    for(uint8_t i=1;i<9;i++)
+      CHECK(leds[i] == CRGB(0, 0, 0));
+    CHECK(leds[0].r >= lastNew);
+    lastNew = leds[0].r;
+    timer0_millis += 10;
+    if(frames > 20)
+      break;
+  }
+  CHECK(leds[0] == colours[0]);                    // Ends on the new digit alone
+  CHECK(leds[9] == CRGB(0, 0, 0));
+  CHECK_EQUAL(snap ? 1 : 16, frames);              // Every 10ms frame of 150ms, plus the one that finishes it
+}
+
+int main() {
+  testSplit();
+  testFade(false);
+  testFade(true);
+  return checkResult("crossfade");
+}
@@ -0,0 +1,134 @@
+/*
+ * Nixie Clock Project
+ * DateTime calendar conversion, field stepping and BCDTime
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "MCP7940.h"
+
+static bool leap(uint16_t year) {
+  return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+static uint8_t monthLength(uint16_t year, uint8_t month) {
+  static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  return days[month - 1] + (month == 2 && leap(year));
+}
+
+//Every day from 2000 to the end of the 32 bit UNIX time, counted one at a time against the closed form
+static void testRoundTrip() {
+  uint32_t time = SECONDS_FROM_1970_TO_2000 + 12 * 3600L + 34 * 60 + 56;
+  uint8_t weekday = 6;                             // 2000-01-01 was a Saturday
+  unsigned failures = 0;
+  for(uint16_t year=2000;year<=2105;year++) {
+    for(uint8_t month=1;month<=12;month++) {
+      for(uint8_t day=1;day<=monthLength(year, month);day++) {
+        DateTime fields(year, month, day, 12, 34, 56);
+        DateTime seconds(time);
+        if(fields.unixtime() != time || seconds.year() != year || seconds.month() != month ||
+           seconds.day() != day || seconds.hour() != 12 || seconds.minute() != 34 || seconds.second() != 56 ||
+           fields.dayOfTheWeek() != weekday || fields.daysInMonth() != monthLength(year, month)) {
+          if(failures++ < 5)
+            printf("%04u-%02u-%02u: %lu, %u\n", year, month, day, (unsigned long)fields.unixtime(), weekday);
+        }
+        time += 86400;
+        weekday = weekday % 7 + 1;
+      }
+    }
+  }
+  CHECK_EQUAL(0, failures);
+  CHECK_EQUAL(2106, DateTime(4294967295UL).year());
+  CHECK_EQUAL(2, DateTime(4294967295UL).month());
+  CHECK_EQUAL(7, DateTime(4294967295UL).day());
+  CHECK_EQUAL(0, DateTime(2000, 1, 1).secondstime());
+}
+
+//Stepping wraps within the 2000-2099 the RTC's two BCD digits hold
+static void testYearRange() {
+  DateTime dt(2099, 12, 31, 23, 59, 59);
+  dt.tick();
+  CHECK_EQUAL(2000, dt.year());
+  CHECK_EQUAL(1, dt.month());
+  CHECK_EQUAL(1, dt.day());
+  CHECK_EQUAL(0, dt.hour());
+  dt.decYear();
+  CHECK_EQUAL(2099, dt.year());
+  dt.incYear();
+  CHECK_EQUAL(2000, dt.year());
+  dt.decMonth();
+  CHECK_EQUAL(2099, dt.year());
+  CHECK_EQUAL(12, dt.month());
+  dt.incMonth();
+  CHECK_EQUAL(2000, dt.year());
+  dt.adjustField(DATETIME_YEAR, -1);
+  CHECK_EQUAL(2099, dt.year());
+  dt.adjustField(DATETIME_YEAR, 2);
+  CHECK_EQUAL(2001, dt.year());
+
+  DateTime past(2105, 6, 1);                        // Past the RTC but still converts, stepping brings it back
+  CHECK_EQUAL(2105, DateTime(past.unixtime()).year());
+  past.incYear();
+  CHECK_EQUAL(2000, past.year());
+  CHECK(DateTime(2000, 1, 1).isLeapYear());
+  CHECK(!DateTime(2100, 1, 1).isLeapYear());
+  CHECK_EQUAL(28, DateTime(2100, 2, 1).daysInMonth());
+}
+
+static void testFields() {
+  DateTime dt(2024, 1, 31, 10, 0, 0);
+  dt.adjustField(DATETIME_MONTH, 1);               // 31 Jan to February, pulled back to the 29th
+  CHECK_EQUAL(2, dt.month());
+  CHECK_EQUAL(29, dt.day());
+  dt.adjustField(DATETIME_YEAR, 1);                // Out of the leap year
+  CHECK_EQUAL(28, dt.day());
+  dt.adjustField(DATETIME_DAY, 1);                 // Wraps within the month
+  CHECK_EQUAL(1, dt.day());
+  CHECK_EQUAL(2, dt.month());
+  dt.adjustField(DATETIME_HOUR, -11);
+  CHECK_EQUAL(23, dt.hour());
+  CHECK_EQUAL(1, dt.day());                        // without carrying
+  dt.adjustField(DATETIME_MINUTE, -1);
+  CHECK_EQUAL(59, dt.minute());
+  CHECK_EQUAL(23, dt.hour());
+
+  DateTime ticked(2024, 2, 28, 23, 59, 30);
+  ticked.tick(45);
+  CHECK_EQUAL(29, ticked.day());
+  CHECK_EQUAL(0, ticked.hour());
+  CHECK_EQUAL(15, ticked.second());
+  ticked = DateTime(2023, 2, 28, 23, 59, 59);
+  ticked.tick();
+  CHECK_EQUAL(3, ticked.month());
+  CHECK_EQUAL(1, ticked.day());
+}
+
+//Every value a field can take packs to its digits and back
+static void testBCD() {
+  for(uint8_t value=0;value<60;value++) {
+    DateTime dt(2000 + value, value % 12 + 1, value % 28 + 1, value % 24, value, value);
+    BCDTime bcd(dt);
+    CHECK_EQUAL(value / 10, bcd.tens(DATETIME_SECOND));
+    CHECK_EQUAL(value % 10, bcd.ones(DATETIME_SECOND));
+    CHECK_EQUAL((value / 10) << 4 | value % 10, bcd.raw(DATETIME_MINUTE));
+    CHECK_EQUAL(value % 24 / 10, bcd.tens(DATETIME_HOUR));
+    CHECK_EQUAL(value % 24 % 10, bcd.ones(DATETIME_HOUR));
+    CHECK_EQUAL(value / 10, bcd.tens(DATETIME_YEAR));
+    CHECK_EQUAL(dt.unixtime(), bcd.toDateTime().unixtime());
+  }
+  BCDTime bcd(DateTime(2099, 12, 31, 23, 59, 58));
+  CHECK_EQUAL(0x99, bcd.raw(DATETIME_YEAR));
+  CHECK_EQUAL(0x12, bcd.raw(DATETIME_MONTH));
+  CHECK_EQUAL(0x31, bcd.raw(DATETIME_DAY));
+  bcd.setRaw(DATETIME_SECOND, 0x59);
+  CHECK_EQUAL(59, bcd.toDateTime().second());
+  CHECK_EQUAL(0, BCDTime().raw(DATETIME_YEAR));
+}
+
+int main() {
+  testRoundTrip();
+  testYearRange();
+  testFields();
+  testBCD();
+  return checkResult("date");
+}
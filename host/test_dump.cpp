@@ -0,0 +1,33 @@
+/*
+ * Nixie Clock Project
+ * NixieClock keeps serial closed while it runs and sends its trace and statistics only when asked
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "NixieClock.ino"
+
+int main() {
+  rtcModel.setTime(2024, 6, 1, 12, 0, 0);
+  setup();
+  board.run(loop, 2000);                           // Start-up messages while the RTC is brought up
+  unsigned long printed = board.serialClosed;
+  board.run(loop, 35000);                          // A few STATS_PERIODs
+  CHECK_EQUAL(printed, board.serialClosed);
+  CHECK(board.serialOut.empty());
+
+  unsigned long start = board.time() / 1000;
+  board.press(start + 100, SW_UP_PIN, 2000);       // Hold UP, then hold DOWN
+  board.press(start + 400, SW_DOWN_PIN, 1000);
+  board.run(loop, 3000);
+  const std::string &out = board.serialOut;
+  size_t block = out.find("TR");
+  CHECK(block != std::string::npos);
+  size_t stats = out.find("Frames rendered: ");
+  CHECK(stats != std::string::npos && stats > block);
+  CHECK(out.find("render worst us: ") != std::string::npos);
+  CHECK(out.find("HSV conversions per s: ") != std::string::npos);
+  CHECK_EQUAL(printed, board.serialClosed);
+  return checkResult("dump");
+}
@@ -0,0 +1,43 @@
+/*
+ * Nixie Clock Project
+ * TempGradient tables against their control points
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "TempGradient.h"
+
+//The indicator turns with the digits it shows, looked up with the rounded temperature
+static void testIndicator() {
+  for(int degrees=-10;degrees<=60;degrees++) {
+    CHSV colour = IndicatorGradient::lookup(GRADIENT_DEGREES(degrees));
+    if(degrees < 35) {
+      CHECK_EQUAL(135, colour.h);
+      CHECK_EQUAL(210, colour.s);
+    } else {
+      CHECK_EQUAL(14, colour.h);
+      CHECK_EQUAL(255, colour.s);
+    }
+  }
+  CHECK_EQUAL(135, IndicatorGradient::lookup(GRADIENT_DEGREES((int)lround(34.49))).h);
+  CHECK_EQUAL(14, IndicatorGradient::lookup(GRADIENT_DEGREES((int)lround(34.5))).h);
+}
+
+static void testClock() {
+  for(const GradientPoint &point : clockGradient) {
+    CHSV colour = ClockGradient::lookup(point.temp);
+    CHECK_EQUAL(point.hue, colour.h);
+    CHECK_EQUAL(point.sat, colour.s);
+  }
+  CHECK_EQUAL(140, ClockGradient::lookup(-40.0f).h);  // Clamped to the end colours
+  CHECK_EQUAL(0, ClockGradient::lookup(45.0f).h);
+  CHECK_EQUAL(9, ClockGradient::lookup(25.1f).h);     // Nearest quarter degree
+  CHECK_EQUAL(8, ClockGradient::lookup(25.5f).h);     // Half way from 9 to 7
+  CHECK_EQUAL((GRADIENT_DEGREES(30) - GRADIENT_DEGREES(15) + 1) * 2, ClockGradient::TABLE_BYTES);
+}
+
+int main() {
+  testIndicator();
+  testClock();
+  return checkResult("gradient");
+}
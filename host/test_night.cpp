@@ -0,0 +1,120 @@
+/*
+ * Nixie Clock Project
+ * NixieClock through a night: powered down between RTC ticks with the ADC off, woken by a button, a double clap on
+ * the peak detector and the morning, with the energy it took
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "NixieClock.ino"
+
+#define MINUTE            60000UL
+
+//Counters at the start of a stretch of the run, for the figures over just that stretch
+struct Energy {
+  unsigned long time, active, idle, down, adc, wakeups;
+
+  Energy() : time(board.time()), active(board.cpuTime[CPU_ACTIVE]), idle(board.cpuTime[CPU_IDLE]),
+             down(board.cpuTime[CPU_POWER_DOWN]), adc(board.adcTime), wakeups(board.wakeups) {}
+
+  double current() const {
+    return ((board.cpuTime[CPU_ACTIVE] - active) * CURRENT_ACTIVE + (board.cpuTime[CPU_IDLE] - idle) * CURRENT_IDLE +
+            (board.cpuTime[CPU_POWER_DOWN] - down) * CURRENT_POWER_DOWN + (board.adcTime - adc) * CURRENT_ADC) /
+           (board.time() - time);
+  }
+};
+
+static bool synced() {
+  return rtcModel.seconds() == now.unixtime() - SECONDS_FROM_1970_TO_2000;
+}
+
+//Runs until the tubes are dark for the night again and the CPU is powering down
+static void untilDeep(unsigned long ms) {
+  for(unsigned long waited=0;waited<ms && !nightDeep;waited+=100)
+    board.run(loop, 100);
+  CHECK(nightDeep);
+}
+
+static void testNight() {
+  Energy day;
+  board.run(loop, 20000);                          // Lit before 23:00
+  CHECK(!nightDark);
+  double dayCurrent = day.current();
+
+  untilDeep(MINUTE);
+  CHECK(!(ADCSRA & bit(ADEN)));
+  CHECK_EQUAL(0, FastLED.getBrightness());
+
+  Energy night;
+  unsigned long millisStart = millis();
+  board.run(loop, 30 * MINUTE);
+  CHECK(synced());
+  CHECK(labs((long)(millis() - millisStart) - (long)(30 * MINUTE)) <= 1000); // Timer0 kept up with the ticks
+  CHECK_EQUAL(night.adc, board.adcTime);
+  CHECK(board.cpuTime[CPU_POWER_DOWN] - night.down > (board.time() - night.time) * 0.95);
+  CHECK((board.wakeups - night.wakeups) / 1800.0 <= 2.1); // Both edges of the square wave
+  CHECK(night.current() < dayCurrent / 20);
+  CHECK(!(EIMSK & bit(INT0)));
+}
+
+//A button release lights the tubes without being taken as a command, then they go dark again
+static void testButton() {
+  unsigned long start = board.time() / 1000;
+  board.press(start + 300, SW_SET_PIN, 1200);      // Would be a long press into set mode by day
+  board.run(loop, 2000);
+  CHECK(!nightDark);
+  CHECK(!nightDeep);
+  CHECK_EQUAL(0, setTimeIndex);
+  CHECK(ADCSRA & bit(ADEN));
+  CHECK(EIMSK & bit(INT0));
+  board.run(loop, 1000);
+  CHECK(FastLED.getBrightness() > 0);
+  CHECK(synced());
+
+  untilDeep(NIGHT_WAKE_TIME + 5000);
+  CHECK(synced());
+}
+
+//Two peaks on the peak detector a clap apart light the tubes with the ADC off, a single one doesn't
+static void testClap() {
+  unsigned long start = board.time() / 1000;
+  board.at(start + 500, ATHRESH_PIN, true);        // Lone knock
+  board.at(start + 520, ATHRESH_PIN, false);
+  board.run(loop, 3000);
+  CHECK(nightDeep);
+
+  start = board.time() / 1000;
+  board.at(start + 500, ATHRESH_PIN, true);
+  board.at(start + 520, ATHRESH_PIN, false);
+  board.at(start + 900, ATHRESH_PIN, true);
+  board.at(start + 920, ATHRESH_PIN, false);
+  board.run(loop, 1500);
+  CHECK(!nightDark);
+  CHECK(!nightDeep);
+  untilDeep(NIGHT_WAKE_TIME + 5000);
+}
+
+//The tubes come back at NIGHT_END with the time right
+static void testMorning() {
+  board.run(loop, 10 * MINUTE);
+  CHECK(nightDeep);
+  rtcModel.setTime(2024, 6, 2, 6, 59, 50);
+  board.run(loop, 12 * MINUTE + 500);              // The next resync finds the jump, then 7:00 comes. Checked
+                                                   // half way through a second, the RTC's count starts afresh
+  CHECK(!nightDark);
+  CHECK(!nightDeep);
+  CHECK(ADCSRA & bit(ADEN));
+  CHECK(FastLED.getBrightness() > 0);
+  CHECK(synced());
+}
+
+int main() {
+  rtcModel.setTime(2024, 6, 1, 22, 59, 20);
+  setup();
+  testNight();
+  testButton();
+  testClap();
+  testMorning();
+  return checkResult("night");
+}
@@ -0,0 +1,90 @@
+/*
+ * Nixie Clock Project
+ * MCP7940 SRAM block reads and writes, split to the Wire buffer and wrapped at the end of the SRAM
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "MCP7940.h"
+
+MCP7940_Class MCP7940;
+
+#define SRAM 0x20
+#define FILL 0xEE
+
+static uint8_t* sram() {
+  return &rtcModel.reg[SRAM];
+}
+
+//Wire buffer sized transactions for a run of bytes, less the register address when writing
+static unsigned chunks(unsigned bytes, unsigned size) {
+  return (bytes + size - 1) / size;
+}
+
+//Every length at every offset, checking the bytes land where they should, nothing else changes and the transfer
+//takes as few transactions as the buffer allows
+static void testEveryBlock() {
+  unsigned failures = 0;
+  for(uint8_t offset=0;offset<MCP7940_RAM_SIZE;offset++) {
+    for(uint8_t len=1;len<=MCP7940_RAM_SIZE;len++) {
+      uint8_t data[MCP7940_RAM_SIZE], back[MCP7940_RAM_SIZE];
+      for(uint8_t i=0;i<len;i++)
+        data[i] = offset * 7 + i + 1;
+      memset(sram(), FILL, MCP7940_RAM_SIZE);
+
+      unsigned before = chunks(min(len, MCP7940_RAM_SIZE - offset), BUFFER_LENGTH - 1);
+      unsigned after = chunks(len - min(len, MCP7940_RAM_SIZE - offset), BUFFER_LENGTH - 1);
+      unsigned long writes = rtcModel.writes;
+      bool ok = MCP7940.writeRAM(offset, data, len) == len && rtcModel.writes - writes == before + after;
+      for(uint8_t i=0;i<MCP7940_RAM_SIZE;i++) {
+        uint8_t at = (i - offset + MCP7940_RAM_SIZE) % MCP7940_RAM_SIZE;  // Index into data for SRAM byte i
+        ok = ok && sram()[i] == (at < len ? data[at] : FILL);
+      }
+
+      before = chunks(min(len, MCP7940_RAM_SIZE - offset), BUFFER_LENGTH);
+      after = chunks(len - min(len, MCP7940_RAM_SIZE - offset), BUFFER_LENGTH);
+      unsigned long transactions = Wire.transactions;
+      ok = ok && MCP7940.readRAM(offset, back, len) == len && memcmp(data, back, len) == 0 &&
+           Wire.transactions - transactions == 2 * (before + after);  // Pointer write and read for each
+      if(!ok && failures++ < 5)
+        printf("offset %u length %u\n", offset, len);
+    }
+  }
+  CHECK_EQUAL(0, failures);
+}
+
+static void testLimits() {
+  uint8_t data[80];
+  for(uint8_t i=0;i<sizeof(data);i++)
+    data[i] = i;
+  memset(sram(), FILL, MCP7940_RAM_SIZE);
+  CHECK_EQUAL(MCP7940_RAM_SIZE, MCP7940.writeRAM(0, data, sizeof(data)));  // Never more than the SRAM holds
+  CHECK_EQUAL(MCP7940_RAM_SIZE - 1, sram()[MCP7940_RAM_SIZE - 1]);
+  CHECK_EQUAL(3, MCP7940.writeRAM(MCP7940_RAM_SIZE + 10, data, 3));         // Address taken modulo 64
+  CHECK_EQUAL(2, sram()[12]);
+  CHECK_EQUAL(0, MCP7940.writeRAM(0, data, 0));
+
+  struct Record {
+    uint32_t stamp;
+    char name[12];
+  } record = { 0x12345678, "nixie" }, copy;
+  CHECK(MCP7940.writeRAM(60, record));             // Template, across the wrap
+  CHECK(MCP7940.readRAM(60, copy));
+  CHECK_EQUAL(0x12345678, copy.stamp);
+  CHECK(strcmp(copy.name, "nixie") == 0);
+  CHECK_EQUAL(0x78, sram()[60]);
+
+  rtcModel.present = false;                        // Bus errors report nothing done
+  CHECK_EQUAL(0, MCP7940.writeRAM(0, data, 8));
+  CHECK_EQUAL(0, MCP7940.readRAM(0, data, 8));
+  CHECK(!MCP7940.readRAM(60, copy));
+  rtcModel.present = true;
+}
+
+int main() {
+  CHECK(MCP7940.begin());
+  testEveryBlock();
+  testLimits();
+  return checkResult("ram");
+}
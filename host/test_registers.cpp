@@ -0,0 +1,124 @@
+/*
+ * Nixie Clock Project
+ * MCP7940 register shadow, burst writes and alarm register writes against the model
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "MCP7940.h"
+
+MCP7940_Class MCP7940;
+
+//A write the RTC never got must not end up in the shadow copy
+static void testFailedWrite() {
+  rtcModel.setTime(2024, 3, 15, 7, 10, 0);
+  CHECK(MCP7940.begin());
+  MCP7940.setRegisterShadow(true);
+  CHECK(MCP7940.setSQWState(true));
+  CHECK(MCP7940.getSQWState());
+
+  rtcModel.present = false;
+  MCP7940.setSQWState(false);
+  rtcModel.present = true;
+  CHECK(rtcModel.reg[0x07] & 0x40);                // SQWEN still set in the device
+  CHECK(MCP7940.getSQWState());                    // and in the shadow
+  MCP7940.invalidateRegisters();
+  CHECK(MCP7940.getSQWState());
+  MCP7940.setSQWState(false);
+  CHECK(!MCP7940.getSQWState());
+  MCP7940.setRegisterShadow(false);
+}
+
+//Setting an alarm again clears the flag left from when it last went off, cached or not
+static void testAlarmFlag(bool shadow) {
+  rtcModel.setTime(2024, 3, 15, 7, 10, 0);
+  CHECK(MCP7940.begin());
+  MCP7940.setRegisterShadow(shadow);
+  MCP7940.setAlarmPolarity(true);
+  CHECK(MCP7940.setAlarm(0, 1, DateTime(2024, 3, 15, 7, 10, 0)));  // Matching the minute, so now
+  board.spend(2000000);
+  CHECK(MCP7940.isAlarm(0));                       // Flag set, and cached with the shadow on
+  CHECK(rtcModel.reg[0x0D] & 0x08);
+
+  CHECK(MCP7940.setAlarm(0, 1, DateTime(2024, 3, 15, 7, 20, 0)));
+  CHECK(!(rtcModel.reg[0x0D] & 0x08));
+  CHECK(!MCP7940.isAlarm(0));
+  CHECK(rtcModel.reg[0x0D] & 0x80);                // ALMPOL kept
+  CHECK_EQUAL(1, (rtcModel.reg[0x0D] >> 4) & 7);
+  CHECK_EQUAL(0x20, rtcModel.reg[0x0B]);           // New minute
+  MCP7940.setRegisterShadow(false);
+}
+
+//The time and each alarm go out as one burst, checked against the model's register file
+static void testBursts() {
+  rtcModel.setTime(2024, 3, 15, 7, 10, 0);
+  CHECK(MCP7940.begin());
+  unsigned long writes = rtcModel.writes;
+  MCP7940.adjust(DateTime(2031, 12, 25, 18, 45, 30));
+  CHECK_EQUAL(2, rtcModel.writes - writes);        // Stopping the oscillator, then every timekeeping register
+  CHECK_EQUAL(0x30, rtcModel.reg[0x00] & 0x7F);
+  CHECK(rtcModel.reg[0x00] & 0x80);                // ST
+  CHECK_EQUAL(0x45, rtcModel.reg[0x01]);
+  CHECK_EQUAL(0x18, rtcModel.reg[0x02]);           // 24 hour
+  CHECK_EQUAL(4, rtcModel.reg[0x03] & 0x07);       // Thursday
+  CHECK_EQUAL(0x25, rtcModel.reg[0x04]);
+  CHECK_EQUAL(0x12, rtcModel.reg[0x05] & 0x1F);
+  CHECK_EQUAL(0x31, rtcModel.reg[0x06]);
+  board.spend(1000000);
+  CHECK_EQUAL(DateTime(2031, 12, 25, 18, 45, 31).unixtime(), MCP7940.now().unixtime());
+
+  MCP7940.setRegisterShadow(true);
+  MCP7940.setAlarmPolarity(true);
+  MCP7940.setAlarmState(0, false);                 // Prime the shadow so only the alarm writes are counted
+  MCP7940.setAlarmState(1, false);
+  writes = rtcModel.writes;
+  CHECK(MCP7940.setAlarm(1, 7, DateTime(2032, 2, 29, 6, 5, 4)));
+  CHECK_EQUAL(3, rtcModel.writes - writes);        // ALM1EN off, the six registers, ALM1EN on
+  CHECK_EQUAL(0x04, rtcModel.reg[0x11]);
+  CHECK_EQUAL(0x05, rtcModel.reg[0x12]);
+  CHECK_EQUAL(0x06, rtcModel.reg[0x13]);
+  CHECK_EQUAL(0x70 | 7, rtcModel.reg[0x14] & 0x77); // All fields, Sunday
+  CHECK_EQUAL(0x29, rtcModel.reg[0x15]);
+  CHECK_EQUAL(0x02, rtcModel.reg[0x16] & 0x1F);
+  CHECK(rtcModel.reg[0x07] & 0x20);
+  MCP7940.setRegisterShadow(false);
+}
+
+//Bits the device changed since the shadow was filled go back as the device has them, not as the copy has them
+static void testHardwareBits() {
+  rtcModel.setTime(2024, 3, 15, 23, 59, 58, 5);    // Friday
+  CHECK(MCP7940.begin());
+  MCP7940.setRegisterShadow(true);
+  MCP7940.setAlarmPolarity(true);
+  MCP7940.setBattery(true);                        // RTCWKDAY and ALM0WKDAY now cached
+  CHECK(MCP7940.getBattery());
+
+  board.spend(3000000);                            // Past midnight, the weekday rolls over in the device
+  rtcModel.reg[0x03] |= 0x10;                      // Power failed
+  rtcModel.reg[0x0D] |= 0x08;                      // Alarm 0 went off
+  MCP7940.setBattery(false);
+  CHECK_EQUAL(6, rtcModel.reg[0x03] & 0x07);       // Saturday kept
+  CHECK(rtcModel.reg[0x03] & 0x10);                // PWRFAIL kept
+  CHECK(!(rtcModel.reg[0x03] & 0x08));
+  MCP7940.setAlarmPolarity(false);
+  CHECK(rtcModel.reg[0x0D] & 0x08);                // ALM0IF kept
+  CHECK(!(rtcModel.reg[0x0D] & 0x80));
+
+  MCP7940.weekdayWrite(2);
+  CHECK(rtcModel.reg[0x03] & 0x10);
+  CHECK_EQUAL(2, rtcModel.reg[0x03] & 0x07);
+  MCP7940.adjust(DateTime(2024, 3, 18, 12, 0, 0));
+  CHECK(rtcModel.reg[0x03] & 0x10);
+  CHECK(MCP7940.getPowerFail());
+  MCP7940.setRegisterShadow(false);
+}
+
+int main() {
+  testFailedWrite();
+  testAlarmFlag(false);
+  testAlarmFlag(true);
+  testBursts();
+  testHardwareBits();
+  return checkResult("registers");
+}
@@ -0,0 +1,47 @@
+/*
+ * Nixie Clock Project
+ * NixieClock bringing up an RTC whose oscillator is slow to start, then losing the RTC and finding it again
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "NixieClock.ino"
+
+//Seconds between the time shown and the RTC's
+static long behind() {
+  return (long)rtcModel.seconds() - (long)(now.unixtime() - SECONDS_FROM_1970_TO_2000);
+}
+
+int main() {
+  rtcModel.setTime(2024, 6, 1, 12, 0, 0);
+  rtcModel.reg[0x00] &= ~0x80;                     // Stopped, as after the backup battery ran out
+  rtcModel.reg[0x03] &= ~0x20;
+  rtcModel.startTime = 300000;                     // Slow crystal
+  setup();
+
+  board.run(loop, 200);
+  CHECK(!rtcReady);
+  CHECK(rtcModel.reg[0x00] & 0x80);                // ST set, waiting for OSCRUN
+  board.run(loop, 300);
+  CHECK(rtcReady);
+  CHECK(scheduler.worstPass() < 15000);            // Nothing blocked for the oscillator
+  CHECK_EQUAL(0, behind());
+
+  board.run(loop, 10000);
+  rtcModel.present = false;                        // Bus fault, the RTC keeps counting
+  board.run(loop, 5000);
+  CHECK(!rtcReady);
+  CHECK_EQUAL(2024, now.year());                   // Not the all zero time of a failed read
+  CHECK(labs(behind()) <= 1);                      // Counted on from the last tick
+  board.run(loop, 60000);
+  CHECK(labs(behind()) <= 1);
+
+  rtcModel.present = true;                         // Retries at BOOT_RETRY_PERIOD gave up, found by the next
+  board.run(loop, RTC_RETRY_PERIOD);               // slow retry
+  CHECK(rtcReady);
+  CHECK_EQUAL(0, behind());
+  board.run(loop, 5000);
+  CHECK_EQUAL(0, behind());
+  return checkResult("rtc_lost");
+}
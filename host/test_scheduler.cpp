@@ -0,0 +1,99 @@
+/*
+ * Nixie Clock Project
+ * Scheduler slots, ordering and tasks that reschedule themselves
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Scheduler.h"
+
+static Scheduler<4> scheduler;
+static unsigned periodicRuns, retryRuns, otherRuns;
+static int8_t retryId, periodicId;
+static unsigned long lastRetry;
+
+static void periodic() {
+  periodicRuns++;
+}
+
+static void other() {
+  otherRuns++;
+}
+
+//One-shot that keeps retrying, like bootRTC() without an RTC
+static void retry() {
+  retryRuns++;
+  lastRetry = millis();
+  retryId = scheduler.after(100, retry, F("retry"));
+}
+
+//Periodic task that swaps itself for a one-shot
+static void replace() {
+  scheduler.cancel(periodicId);
+  scheduler.after(5, other, F("other"));
+}
+
+//Runs the scheduler for ms, a pass every millisecond
+static void runFor(unsigned long ms) {
+  for(unsigned long i=0;i<ms;i++) {
+    board.spend(1000);
+    scheduler.run();
+  }
+}
+
+static void testFullSelfReschedule() {
+  for(uint8_t i=0;i<3;i++)
+    CHECK(scheduler.every(10, periodic, F("periodic")) != TASK_NONE);
+  retryId = scheduler.after(0, retry, F("retry"));
+  CHECK(retryId != TASK_NONE);
+  CHECK_EQUAL(TASK_NONE, scheduler.after(0, other, F("other")));  // Every slot taken
+
+  runFor(1000);
+  CHECK_EQUAL(3 * 101, periodicRuns);              // Due at 0 to 1000ms
+  CHECK(retryRuns >= 10);                          // Rescheduled into its own slot each time
+  CHECK(retryId != TASK_NONE);
+  CHECK(scheduler.isScheduled(retryId));
+  CHECK(millis() - lastRetry <= 100);
+  CHECK_EQUAL(TASK_NONE, scheduler.after(0, other, F("other")));  // Still full, nothing leaked
+
+  scheduler.cancel(retryId);
+  CHECK(scheduler.after(0, other, F("other")) != TASK_NONE);
+  runFor(10);
+  CHECK_EQUAL(1, otherRuns);
+  for(int8_t id=0;id<4;id++)
+    scheduler.cancel(id);
+}
+
+static void testSwapWhileRunning() {
+  otherRuns = 0;
+  periodicRuns = 0;
+  periodicId = scheduler.every(10, replace, F("replace"));
+  runFor(15);                                      // Replaced by the one-shot in its own slot
+  runFor(100);
+  CHECK_EQUAL(1, otherRuns);                       // Not run again as if it were still periodic
+  CHECK(!scheduler.isScheduled(periodicId));
+}
+
+static void testOrder() {
+  static char order[8];
+  static uint8_t count;
+  struct Tasks {
+    static void a() { order[count++] = 'a'; }
+    static void b() { order[count++] = 'b'; }
+    static void c() { order[count++] = 'c'; }
+  };
+  count = 0;
+  scheduler.after(30, Tasks::c, F("c"));
+  scheduler.after(10, Tasks::a, F("a"));
+  scheduler.after(20, Tasks::b, F("b"));
+  runFor(40);
+  order[count] = 0;
+  CHECK(strcmp(order, "abc") == 0);
+}
+
+int main() {
+  testFullSelfReschedule();
+  testSwapWhileRunning();
+  testOrder();
+  return checkResult("scheduler");
+}
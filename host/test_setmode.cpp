@@ -0,0 +1,31 @@
+/*
+ * Nixie Clock Project
+ * NixieClock's set mode entered and left without changing anything, the time it stood still is not taken as drift
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "NixieClock.ino"
+
+int main() {
+  rtcModel.setTime(2024, 6, 1, 12, 0, 0);
+  setup();
+  board.run(loop, 2000);
+  CHECK(rtcReady);
+  MCP7940.setSetUnixTime(MCP7940.now().unixtime() - 3 * 86400UL); // Calibration record from 3 days ago
+  uint8_t trim = rtcModel.reg[0x08];
+
+  unsigned long start = board.time() / 1000;
+  board.press(start + 100, SW_SET_PIN, 1200);      // Long press into set mode
+  board.run(loop, 2000);
+  CHECK_EQUAL(1, setTimeIndex);
+  board.run(loop, 10000);                          // Shown time stands still while editing
+  start = board.time() / 1000;
+  board.press(start + 100, SW_SET_PIN, 1200);      // and out again, nothing changed
+  board.run(loop, 2500);
+  CHECK_EQUAL(0, setTimeIndex);
+  CHECK_EQUAL(trim, rtcModel.reg[0x08]);           // OSCTRIM left alone
+  CHECK_EQUAL(rtcModel.seconds(), now.unixtime() - SECONDS_FROM_1970_TO_2000);
+  return checkResult("setmode");
+}
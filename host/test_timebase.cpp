@@ -0,0 +1,42 @@
+/*
+ * Nixie Clock Project
+ * NixieClock counting the RTC's square wave, with the RTC read over I2C only to resynchronise
+ */
+
+#include <Arduino.h>
+#include "Check.h"
+#include "Devices.h"
+#include "NixieClock.ino"
+
+//Runs the clock a second at a time, checking the time it holds against the RTC, returns RTC transactions a second
+static double runFor(unsigned seconds) {
+  unsigned long transactions = rtcModel.transactions;
+  unsigned wrong = 0;
+  for(unsigned i=0;i<seconds;i++) {
+    board.run(loop, 1000);
+    if(now.unixtime() - SECONDS_FROM_1970_TO_2000 != rtcModel.seconds())
+      wrong++;
+  }
+  CHECK(wrong <= 1);                                // Can be a pass behind at most once as the wiring changes
+  return (double)(rtcModel.transactions - transactions) / seconds;
+}
+
+int main() {
+  rtcModel.setTime(2024, 6, 1, 12, 0, 0);
+  setup();
+  board.run(loop, 2000);
+  CHECK(rtcReady);
+
+  double counted = runFor(120);
+  CHECK(counted < 0.1);                            // A resync every RTC_SYNC_PERIOD, not a read a second
+
+  board.mfpPin = 0xFF;                             // Square wave lost, falls back to reading the RTC
+  double polled = runFor(20);
+  CHECK(polled > 10);
+
+  board.mfpPin = 2;                                // Edges back, reads stop again
+  runFor(5);
+  counted = runFor(60);
+  CHECK(counted < 0.1);
+  return checkResult("timebase");
+}
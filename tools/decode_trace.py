@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+Nixie Clock Project
+Decodes the binary trace the clock sends when UP is held and DOWN is held after it
+
+Capture the serial port to a file while dumping, e.g. on Linux
+    stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > trace.bin
+then run
+    python3 decode_trace.py trace.bin
+
+Each block is printed as a timeline, times in seconds from its first record, followed by a histogram of the events
+that log a duration. Anything between blocks (text the sketch printed) is skipped.
+
+The event ids and button numbers have to match the TRACE_* and BTN_* defines in NixieClock.ino and the event types
+in Buttons.h.
+"""
+
+import struct
+import sys
+
+MAGIC = ord('T')
+KINDS = {ord('R'): 'Live trace', ord('S'): 'Saved trace'}
+HEADER = struct.Struct('<BBB')
+RECORD = struct.Struct('<HBH')
+
+EVENTS = ['RTC up', 'RTC read', 'Sensor read', 'Button', 'Clap', 'Push', 'Overrun', 'Frames', 'Alarm',
+          'No task slot', 'RTC lost']
+TIMED = {1, 2, 5, 6}           # Events whose value is a duration in us
+BUTTONS = ['SET', 'MODE', 'UP', 'DOWN']
+BUTTON_EVENTS = ['press', 'release', 'short', 'long', 'held']
+ALARM_EVENTS = ['stopped', 'went off', 'snoozed']
+
+
+def blocks(data):
+    """Yields (kind, records) for every block found in the capture"""
+    i = 0
+    while i + HEADER.size <= len(data):
+        magic, kind, count = HEADER.unpack_from(data, i)
+        end = i + HEADER.size + count * RECORD.size
+        if magic != MAGIC or kind not in KINDS or end > len(data):
+            i += 1
+            continue
+        records = [RECORD.unpack_from(data, i + HEADER.size + n * RECORD.size) for n in range(count)]
+        yield KINDS[kind], records
+        i = end
+
+
+def describe(event, value):
+    if event in TIMED:
+        return '%d us' % value
+    if event == 0:
+        return 'after %d tries' % value
+    if event == 3:
+        button, kind = value >> 8, value & 0xFF
+        name = BUTTONS[button] if button < len(BUTTONS) else 'button %d' % button
+        return '%s %s' % (name, BUTTON_EVENTS[kind] if kind < len(BUTTON_EVENTS) else kind)
+    if event == 4:
+        return 'x%d' % value
+    if event == 8:
+        return ALARM_EVENTS[value] if value < len(ALARM_EVENTS) else str(value)
+    return str(value)
+
+
+def timeline(records):
+    """Prints every record, the 16 bit millis() is unwrapped assuming records are under 65s apart"""
+    elapsed = 0
+    frames = None
+    for n, (time, event, value) in enumerate(records):
+        delta = (time - records[n - 1][0]) & 0xFFFF if n else 0
+        elapsed += delta
+        name = EVENTS[event] if event < len(EVENTS) else 'Event %d' % event
+        text = describe(event, value)
+        if event == 7:
+            if frames is not None:
+                text += ' (+%d)' % ((value - frames) & 0xFFFF)
+            frames = value
+        print('%9.3f  +%5d ms  %-12s %s' % (elapsed / 1000.0, delta, name, text))
+
+
+def histogram(name, values):
+    """Counts durations in power of 2 buckets"""
+    buckets = {}
+    for value in values:
+        bucket = max(value, 1).bit_length()
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+    most = max(buckets.values())
+    print('%s, %d samples, min %d us, max %d us, mean %d us' %
+          (name, len(values), min(values), max(values), sum(values) // len(values)))
+    for bucket in range(min(buckets), max(buckets) + 1):
+        count = buckets.get(bucket, 0)
+        low, high = (1 << (bucket - 1)) if bucket > 1 else 0, (1 << bucket) - 1
+        print('  %6d-%-6d us %5d %s' % (low, high, count, '#' * (count * 40 // most)))
+
+
+def main():
+    data = open(sys.argv[1], 'rb').read() if len(sys.argv) > 1 else sys.stdin.buffer.read()
+    found = False
+    for kind, records in blocks(data):
+        found = True
+        print('%s, %d records' % (kind, len(records)))
+        timeline(records)
+        for event in sorted(TIMED):
+            values = [value for (time, e, value) in records if e == event]
+            if values:
+                histogram(EVENTS[event], values)
+        print()
+    if not found:
+        sys.exit('No trace blocks found')
+
+
+if __name__ == '__main__':
+    main()